@@ -0,0 +1,387 @@
+/*
+ * board.cc
+ * This file is part of GoL Lab, a simulator of Conway's game of life.
+ *
+ * Copyright (C) 2022-2023 Cyprien Lacassagne
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cctype>
+#include "board.h"
+#include "simulation.h"
+
+namespace {
+    inline void full_add(uint64_t a, uint64_t b, uint64_t c, uint64_t& sum, uint64_t& carry);
+    // The four bits of the number of live neighbours of each cell
+    inline void count(uint64_t up, uint64_t up_west, uint64_t up_east,
+                      uint64_t west, uint64_t east,
+                      uint64_t down, uint64_t down_west, uint64_t down_east,
+                      uint64_t bits[4]);
+    inline uint64_t match(const uint64_t bits[4], unsigned n);
+    inline uint64_t apply(const Rule& rule, bool life, const uint64_t bits[4], uint64_t alive);
+} /* unnamed namespace */
+
+bool parse_rule(std::string text, Rule& rule) {
+    // Older files write the survival counts, a slash and the birth counts
+    const size_t slash(text.find('/'));
+    if (slash != std::string::npos && text.find_first_not_of("012345678/") == std::string::npos
+        && text.find('/', slash + 1) == std::string::npos)
+        text = "B" + text.substr(slash + 1) + "/S" + text.substr(0, slash);
+
+    Rule decoded({0, 0});
+    uint16_t* counts(nullptr);
+    bool seen_birth(false);
+    bool seen_survival(false);
+    for (auto c : text) {
+        c = std::toupper(c);
+        if (c == 'B' && !seen_birth) {
+            counts = &decoded.birth;
+            seen_birth = true;
+        } else if (c == 'S' && !seen_survival) {
+            counts = &decoded.survival;
+            seen_survival = true;
+        } else if (c >= '0' && c <= '8' && counts) {
+            *counts |= 1 << (c - '0');
+        } else if (c != '/' || !counts) {
+            return false;
+        }
+    }
+    if (!seen_birth || !seen_survival || (decoded.birth & 1))
+        return false;
+    rule = decoded;
+    return true;
+}
+
+std::string rule_name(const Rule& rule) {
+    std::string name("B");
+    for (unsigned n(0); n <= 8; ++n) {
+        if (rule.birth & (1 << n))
+            name += '0' + n;
+    }
+    name += "/S";
+    for (unsigned n(0); n <= 8; ++n) {
+        if (rule.survival & (1 << n))
+            name += '0' + n;
+    }
+    return name;
+}
+
+uint64_t next_row(uint64_t up, uint64_t row, uint64_t down, const Rule& rule) {
+    uint64_t bits[4];
+    count(up << 1, up, up >> 1, row << 1, row >> 1, down << 1, down, down >> 1, bits);
+    return apply(rule, rule.birth == life_rule.birth && rule.survival == life_rule.survival,
+                 bits, row);
+}
+
+Board::Board(unsigned width, unsigned height, Rule rule)
+:   width((width + 63) / 64 * 64),
+    height(height),
+    words_per_row((width + 63) / 64),
+    stride(words_per_row + 2),
+    rule(rule),
+    words((size_t)stride * height, 0),
+    occupied(height, 0),
+    changed(height, 0),
+    n_alive(0),
+    row_min(1),
+    row_max(0),
+    word_min(1),
+    word_max(0),
+    saved_up(stride, 0),
+    saved_row(stride, 0),
+    dead_row(stride, 0) {}
+
+unsigned Board::get_width() const {
+    return width;
+}
+
+unsigned Board::get_height() const {
+    return height;
+}
+
+const Rule& Board::get_rule() const {
+    return rule;
+}
+
+void Board::set_rule(const Rule& rule) {
+    this->rule = rule;
+    // Any cell may now behave differently
+    for (unsigned y(row_min); y <= row_max; ++y) {
+        changed[y] |= occupied[y];
+    }
+}
+
+void Board::clear() {
+    for (unsigned y(row_min); y <= row_max; ++y) {
+        std::fill(words.begin() + (size_t)y * stride + 1 + word_min,
+                  words.begin() + (size_t)y * stride + 1 + word_max + 1, 0);
+        occupied[y] = 0;
+        changed[y] = 0;
+    }
+    n_alive = 0;
+    row_min = word_min = 1;
+    row_max = word_max = 0;
+}
+
+bool Board::get(unsigned x, unsigned y) const {
+    return (words[(size_t)y * stride + 1 + x / 64] >> (x % 64)) & 1;
+}
+
+void Board::set(unsigned x, unsigned y, bool alive) {
+    uint64_t& word(words[(size_t)y * stride + 1 + x / 64]);
+    const uint64_t bit(uint64_t(1) << (x % 64));
+    if (((word & bit) != 0) == alive)
+        return;
+    word ^= bit;
+    changed[y] |= uint64_t(1) << (x / 64);
+    if (alive) {
+        ++n_alive;
+        occupied[y] |= uint64_t(1) << (x / 64);
+        extend(x, y);
+    } else {
+        --n_alive;
+        if (word == 0)
+            occupied[y] &= ~(uint64_t(1) << (x / 64));
+    }
+}
+
+void Board::step() {
+    if (row_min > row_max)
+        return;
+
+    // Births happen at most one cell away from the live cells
+    const unsigned y_begin(row_min > 0 ? row_min - 1 : 0);
+    const unsigned y_end(std::min(row_max + 1, height - 1));
+    const unsigned w_begin(word_min > 0 ? word_min - 1 : 0);
+    const unsigned w_end(std::min(word_max + 1, words_per_row - 1));
+    const uint64_t window((~uint64_t(0) >> (63 - w_end)) & (~uint64_t(0) << w_begin));
+    const bool life(rule.birth == life_rule.birth && rule.survival == life_rule.survival);
+
+    // The rows are replaced in place, up points to the row above as it was
+    // before. The words out of the board are read from the guard words.
+    const uint64_t* up(&dead_row[1]);
+    uint64_t flags_up(y_begin > 0 ? changed[y_begin - 1] : 0);
+    for (unsigned y(y_begin); y <= y_end; ++y) {
+        uint64_t* row(&words[(size_t)y * stride + 1]);
+        const uint64_t* down(y + 1 < height ? row + stride : &dead_row[1]);
+        const uint64_t flags_down(y + 1 < height ? changed[y + 1] : 0);
+        // A word can only change if a word around it changed in the last generation
+        const uint64_t around(flags_up | changed[y] | flags_down);
+        const uint64_t active((around | (around << 1) | (around >> 1)) & window);
+        flags_up = changed[y];
+        changed[y] = 0;
+        if (active == 0) {
+            up = row;
+            continue;
+        }
+
+        // Keep the row as it was, from word w_begin - 1 to word w_end + 1
+        // (guard words included)
+        for (unsigned i(w_begin); i <= w_end + 2; ++i) {
+            saved_row[i] = words[(size_t)y * stride + i];
+        }
+        const uint64_t* old(&saved_row[1]);
+        for (uint64_t left(active); left != 0; left &= left - 1) {
+            const unsigned w(__builtin_ctzll(left));
+            const uint64_t* c(old + w);
+            const uint64_t* u(up + w);
+            const uint64_t* d(down + w);
+            const uint64_t c_0(c[-1]), c_1(c[0]), c_2(c[1]);
+            const uint64_t u_0(u[-1]), u_1(u[0]), u_2(u[1]);
+            const uint64_t d_0(d[-1]), d_1(d[0]), d_2(d[1]);
+            uint64_t bits[4];
+            count((u_1 << 1) | (u_0 >> 63), u_1, (u_1 >> 1) | (u_2 << 63),
+                  (c_1 << 1) | (c_0 >> 63), (c_1 >> 1) | (c_2 << 63),
+                  (d_1 << 1) | (d_0 >> 63), d_1, (d_1 >> 1) | (d_2 << 63), bits);
+            const uint64_t cells(apply(rule, life, bits, c_1));
+            if (cells == c_1)
+                continue;
+            // The neighbours are read from old, the row can be written at once
+            const uint64_t bit(uint64_t(1) << w);
+            row[w] = cells;
+            changed[y] |= bit;
+            n_alive += __builtin_popcountll(cells & ~c_1);
+            n_alive -= __builtin_popcountll(c_1 & ~cells);
+            if (cells != 0)
+                occupied[y] |= bit;
+            else
+                occupied[y] &= ~bit;
+        }
+        std::swap(saved_up, saved_row);
+        up = &saved_up[1];
+    }
+    tighten(y_begin, y_end);
+}
+
+unsigned Board::population() const {
+    return n_alive;
+}
+
+bool Board::empty() const {
+    return n_alive == 0;
+}
+
+uint64_t Board::hash() const {
+    uint64_t h(0x9e3779b97f4a7c15);
+    for (unsigned y(row_min); y <= row_max; ++y) {
+        for (uint64_t left(occupied[y]); left != 0; left &= left - 1) {
+            const unsigned w(__builtin_ctzll(left));
+            h ^= words[(size_t)y * stride + 1 + w] + ((uint64_t)y << 32 | w) * 0xbf58476d1ce4e5b9;
+            h = (h ^ (h >> 31)) * 0x94d049bb133111eb;
+        }
+    }
+    return h;
+}
+
+simulation::BoundingBox Board::bounding_box() const {
+    simulation::BoundingBox box({1, 0, 1, 0});
+    uint64_t any(0);
+    for (unsigned y(row_min); y <= row_max; ++y) {
+        if (occupied[y] == 0)
+            continue;
+        if (any == 0)
+            box.y_min = y;
+        box.y_max = y;
+        any |= occupied[y];
+    }
+    if (any == 0)
+        return box;
+
+    // The extreme words are known, look for their extreme cells
+    const unsigned w_low(__builtin_ctzll(any));
+    const unsigned w_high(63 - __builtin_clzll(any));
+    uint64_t low(0), high(0);
+    for (unsigned y(box.y_min); y <= box.y_max; ++y) {
+        low |= words[(size_t)y * stride + 1 + w_low];
+        high |= words[(size_t)y * stride + 1 + w_high];
+    }
+    box.x_min = w_low * 64 + __builtin_ctzll(low);
+    box.x_max = w_high * 64 + 63 - __builtin_clzll(high);
+    return box;
+}
+
+bool Board::near_edge(unsigned margin) const {
+    // The rows are exact after a step but the words are not, look closer only if needed
+    if (row_min > row_max)
+        return false;
+    if (row_min >= margin && row_max + margin < height && word_min > 0
+        && word_max + 1 < words_per_row)
+        return false;
+    const simulation::BoundingBox box(bounding_box());
+    if (box.x_min > box.x_max)
+        return false;
+    return box.x_min < margin || box.x_max + margin >= width || box.y_min < margin
+           || box.y_max + margin >= height;
+}
+
+std::vector<Coordinates> Board::live_cells() const {
+    std::vector<Coordinates> cells;
+    for (unsigned y(row_min); y <= row_max; ++y) {
+        for (uint64_t left(occupied[y]); left != 0; left &= left - 1) {
+            const unsigned w(__builtin_ctzll(left));
+            uint64_t word(words[(size_t)y * stride + 1 + w]);
+            while (word != 0) {
+                cells.push_back({w * 64 + __builtin_ctzll(word), y});
+                word &= word - 1;
+            }
+        }
+    }
+    return cells;
+}
+
+void Board::extend(unsigned x, unsigned y) {
+    if (row_min > row_max) {
+        row_min = row_max = y;
+        word_min = word_max = x / 64;
+        return;
+    }
+    row_min = std::min(row_min, y);
+    row_max = std::max(row_max, y);
+    word_min = std::min(word_min, x / 64);
+    word_max = std::max(word_max, x / 64);
+}
+
+// Make the window exact, the live cells being between rows y_begin and y_end
+void Board::tighten(unsigned y_begin, unsigned y_end) {
+    uint64_t any(0);
+    row_min = 1;
+    row_max = 0;
+    for (unsigned y(y_begin); y <= y_end; ++y) {
+        if (occupied[y] == 0)
+            continue;
+        if (any == 0)
+            row_min = y;
+        row_max = y;
+        any |= occupied[y];
+    }
+    if (any == 0) {
+        row_min = word_min = 1;
+        row_max = word_max = 0;
+        return;
+    }
+    word_min = __builtin_ctzll(any);
+    word_max = 63 - __builtin_clzll(any);
+}
+
+namespace {
+    void full_add(uint64_t a, uint64_t b, uint64_t c, uint64_t& sum, uint64_t& carry) {
+        const uint64_t half(a ^ b);
+        sum = half ^ c;
+        carry = (a & b) | (half & c);
+    }
+
+    void count(uint64_t up, uint64_t up_west, uint64_t up_east,
+               uint64_t west, uint64_t east,
+               uint64_t down, uint64_t down_west, uint64_t down_east,
+               uint64_t bits[4]) {
+        uint64_t up_0, up_1, down_0, down_1;
+        full_add(up_west, up, up_east, up_0, up_1);
+        full_add(down_west, down, down_east, down_0, down_1);
+        const uint64_t middle_0(west ^ east);
+        const uint64_t middle_1(west & east);
+
+        uint64_t carry_1, twos, carry_2;
+        full_add(up_0, down_0, middle_0, bits[0], carry_1);
+        full_add(up_1, down_1, middle_1, twos, carry_2);
+        bits[1] = twos ^ carry_1;
+        const uint64_t carry_twos(twos & carry_1);
+        bits[2] = carry_2 ^ carry_twos;
+        bits[3] = carry_2 & carry_twos;
+    }
+
+    uint64_t match(const uint64_t bits[4], unsigned n) {
+        uint64_t result(~uint64_t(0));
+        for (unsigned b(0); b < 4; ++b) {
+            result &= ((n >> b) & 1) ? bits[b] : ~bits[b];
+        }
+        return result;
+    }
+
+    uint64_t apply(const Rule& rule, bool life, const uint64_t bits[4], uint64_t alive) {
+        // 2 or 3 neighbours, and 3 or alive
+        if (life)
+            return bits[1] & ~bits[2] & ~bits[3] & (bits[0] | alive);
+
+        uint64_t result(0);
+        for (unsigned n(0); n <= 8; ++n) {
+            if (rule.birth & (1 << n))
+                result |= match(bits, n) & ~alive;
+            if (rule.survival & (1 << n))
+                result |= match(bits, n) & alive;
+        }
+        return result;
+    }
+} /* unnamed namespace */
@@ -0,0 +1,145 @@
+/*
+ * board.h
+ * This module implements a small bounded world, one bit per cell, under
+ * any B/S rule without B0. It is meant for the searches, which run
+ * thousands of independent worlds on worker threads: it does not touch
+ * the state of the simulation and only steps the rectangle that holds
+ * live cells.
+ *
+ * This file is part of GoL Lab, a simulator of Conway's game of life.
+ *
+ * Copyright (C) 2022-2023 Cyprien Lacassagne
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "config.h"
+
+namespace simulation {
+    struct BoundingBox;
+}
+
+// Bit n is set if a cell with n live neighbours is born (birth) or survives (survival)
+struct Rule {
+    uint16_t birth;
+    uint16_t survival;
+};
+
+constexpr Rule life_rule({1 << 3, (1 << 2) | (1 << 3)});
+
+/**
+ * Decode a rule written "B3/S23" (or "b3/s23", "B3S23", "23/3").
+ * @param rule Set to the decoded rule on success.
+ * @return false if the text is not a rule or is a B0 rule.
+ */
+bool parse_rule(std::string text, Rule& rule);
+
+/**
+ * @return The rule written "B3/S23".
+ */
+std::string rule_name(const Rule& rule);
+
+/**
+ * @return The next generation of a row of 64 cells between the rows up and
+ * down, the cells beyond both ends being dead.
+ */
+uint64_t next_row(uint64_t up, uint64_t row, uint64_t down, const Rule& rule = life_rule);
+
+class Board {
+public:
+    /**
+     * Create an empty board. The cells out of the board are always dead.
+     * @param width Rounded up to a multiple of 64, at most 62 * 64.
+     */
+    Board(unsigned width, unsigned height, Rule rule = life_rule);
+
+    unsigned get_width() const;
+    unsigned get_height() const;
+    const Rule& get_rule() const;
+    void set_rule(const Rule& rule);
+
+    /**
+     * Kill every cell.
+     */
+    void clear();
+
+    bool get(unsigned x, unsigned y) const;
+    void set(unsigned x, unsigned y, bool alive = true);
+
+    /**
+     * Compute the next generation.
+     */
+    void step();
+
+    unsigned population() const;
+    bool empty() const;
+
+    /**
+     * @return A hash of the live cells and their position.
+     */
+    uint64_t hash() const;
+
+    /**
+     * @return The smallest rectangle holding the live cells, x_min > x_max if
+     * the board is empty.
+     */
+    simulation::BoundingBox bounding_box() const;
+
+    /**
+     * @return Whether a live cell is less than margin cells away from the edge.
+     */
+    bool near_edge(unsigned margin) const;
+
+    /**
+     * @return The live cells, row by row.
+     */
+    std::vector<Coordinates> live_cells() const;
+
+private:
+    // Row y starts at word y * stride, cell x is bit x % 64 of word x / 64 + 1.
+    // The first and last words of a row are dead guards.
+    unsigned width;
+    unsigned height;
+    unsigned words_per_row;
+    unsigned stride;
+    Rule rule;
+    std::vector<uint64_t> words;
+    // Bit w of row y is set if word w holds live cells
+    std::vector<uint64_t> occupied;
+    // Bit w of row y is set if word w may have changed in the last generation
+    std::vector<uint64_t> changed;
+    unsigned n_alive;
+    // Rows and words of a row that may hold live cells, empty if row_min > row_max.
+    // step() leaves them exact.
+    unsigned row_min;
+    unsigned row_max;
+    unsigned word_min;
+    unsigned word_max;
+    // Rows y - 1 and y of the generation being replaced
+    std::vector<uint64_t> saved_up;
+    std::vector<uint64_t> saved_row;
+    // Row above and below the board
+    std::vector<uint64_t> dead_row;
+
+    void extend(unsigned x, unsigned y);
+    void tighten(unsigned y_begin, unsigned y_end);
+};
+
+#endif
@@ -0,0 +1,89 @@
+/*
+ * bookmark.cc
+ * This file is part of GoL Lab, a simulator of Conway's game of life.
+ *
+ * Copyright (C) 2022-2023 Cyprien Lacassagne
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include "bookmark.h"
+#include "simulation.h"
+
+namespace {
+    std::vector<bookmark::Bookmark> bookmarks;
+
+    uint64_t word_at(const bookmark::Bookmark& snapshot, unsigned y, unsigned w);
+    void extract_cells(uint64_t bits, unsigned x_0, unsigned y, std::vector<Coordinates>& cells);
+} /* unnamed namespace */
+
+bookmark::Bookmark bookmark::take(std::string name, unsigned long generation) {
+    const unsigned width(simulation::get_width());
+    const unsigned height(simulation::get_height());
+    const unsigned words_per_row((width + 63) / 64);
+    Bookmark snapshot({name, generation, width, height, words_per_row,
+                       std::vector<uint64_t>((size_t)words_per_row * height, 0)});
+    for (auto& cell : simulation::get_live_cells()) {
+        snapshot.words[(size_t)cell.y * words_per_row + cell.x / 64] |= uint64_t(1) << (cell.x % 64);
+    }
+    return snapshot;
+}
+
+void bookmark::add(std::string name, unsigned long generation) {
+    bookmarks.push_back(take(name, generation));
+}
+
+const std::vector<bookmark::Bookmark>& bookmark::get_bookmarks() {
+    return bookmarks;
+}
+
+void bookmark::clear() {
+    bookmarks.clear();
+}
+
+bookmark::Diff bookmark::compare(const Bookmark& before, const Bookmark& after) {
+    Diff diff({{}, {}, 0});
+    const unsigned height(std::max(before.height, after.height));
+    const unsigned words_per_row(std::max(before.words_per_row, after.words_per_row));
+    for (unsigned y(0); y < height; ++y) {
+        for (unsigned w(0); w < words_per_row; ++w) {
+            const uint64_t a(word_at(before, y, w));
+            const uint64_t b(word_at(after, y, w));
+            const uint64_t changed(a ^ b);
+            diff.unchanged += __builtin_popcountll(a & b);
+            if (changed == 0)
+                continue;
+            extract_cells(changed & b, w * 64, y, diff.added);
+            extract_cells(changed & a, w * 64, y, diff.removed);
+        }
+    }
+    return diff;
+}
+
+namespace {
+    // Cells out of the snapshot are dead
+    uint64_t word_at(const bookmark::Bookmark& snapshot, unsigned y, unsigned w) {
+        if (y >= snapshot.height || w >= snapshot.words_per_row)
+            return 0;
+        return snapshot.words[(size_t)y * snapshot.words_per_row + w];
+    }
+
+    void extract_cells(uint64_t bits, unsigned x_0, unsigned y, std::vector<Coordinates>& cells) {
+        while (bits != 0) {
+            cells.push_back({x_0 + __builtin_ctzll(bits), y});
+            bits &= bits - 1;
+        }
+    }
+} /* unnamed namespace */
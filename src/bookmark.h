@@ -0,0 +1,81 @@
+/*
+ * bookmark.h
+ * This module keeps named snapshots of the world, one bit per cell, and
+ * compares two of them word by word to find the cells that were added,
+ * removed or left unchanged.
+ *
+ * This file is part of GoL Lab, a simulator of Conway's game of life.
+ *
+ * Copyright (C) 2022-2023 Cyprien Lacassagne
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BOOKMARK_H
+#define BOOKMARK_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "config.h"
+
+namespace bookmark {
+    struct Bookmark {
+        std::string name;
+        unsigned long generation;
+        unsigned width;
+        unsigned height;
+        // Row y starts at word y * words_per_row, cell x is bit x % 64 of word x / 64
+        unsigned words_per_row;
+        std::vector<uint64_t> words;
+    };
+
+    struct Diff {
+        std::vector<Coordinates> added;
+        std::vector<Coordinates> removed;
+        unsigned long unchanged;
+    };
+
+    /**
+     * Pack the current state of the simulation.
+     * @param name Name of the snapshot.
+     * @param generation Generation the snapshot is taken at.
+     */
+    Bookmark take(std::string name, unsigned long generation);
+
+    /**
+     * Keep a snapshot of the current state of the simulation.
+     */
+    void add(std::string name, unsigned long generation);
+
+    /**
+     * @return The bookmarks, in the order they were added.
+     */
+    const std::vector<Bookmark>& get_bookmarks();
+
+    /**
+     * Forget all the bookmarks, when another pattern is loaded.
+     */
+    void clear();
+
+    /**
+     * Compare two snapshots, which may be of different world sizes.
+     * @return The live cells of after that are dead in before (added), the live
+     * cells of before that are dead in after (removed) and the number of cells
+     * alive in both.
+     */
+    Diff compare(const Bookmark& before, const Bookmark& after);
+} /* namespace bookmark */
+
+#endif
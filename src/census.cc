@@ -0,0 +1,580 @@
+/*
+ * census.cc
+ * This file is part of GoL Lab, a simulator of Conway's game of life.
+ *
+ * Copyright (C) 2022-2023 Cyprien Lacassagne
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include "census.h"
+#include "config.h"
+
+namespace {
+    struct Cell {
+        int x;
+        int y;
+    };
+
+    typedef std::vector<Cell> Cells;
+
+    // Live cells of the world, row after row, sorted by column within a row
+    struct LiveCells {
+        std::vector<unsigned> xs;
+        std::vector<unsigned> row_start;
+    };
+
+    // Cells at most this far apart belong to the same object
+    constexpr unsigned merge_distance(2);
+
+    const std::string base32("0123456789abcdefghijklmnopqrstuv");
+
+    // Common objects of Conway's Life, by apgcode
+    const std::map<std::string, std::string> object_names {
+        {"xs4_33", "block"},
+        {"xp2_7", "blinker"},
+        {"xs6_696", "beehive"},
+        {"xq4_153", "glider"},
+        {"xs7_2596", "loaf"},
+        {"xs5_253", "boat"},
+        {"xs4_252", "tub"},
+        {"xs8_6996", "pond"},
+        {"xs6_356", "ship"},
+        {"xs6_25a4", "barge"},
+        {"xs7_25ac", "long boat"},
+        {"xp2_7e", "toad"},
+        {"xp2_318c", "beacon"},
+        {"xs8_69ic", "mango"},
+        {"xs8_25ak8", "long barge"},
+        {"xs7_178c", "eater 1"},
+        {"xs6_bd", "snake"},
+        {"xs6_39c", "aircraft carrier"},
+        {"xs9_31ego", "integral sign"},
+        {"xs8_3pm", "shillelagh"},
+        {"xs8_rr", "bi-block"},
+        {"xs8_35ac", "long ship"},
+        {"xs8_178k8", "tub with tail"},
+        {"xs8_312ko", "canoe"},
+        {"xs9_4aar", "hat"},
+        {"xs9_25ako", "very long boat"},
+        {"xs9_178ko", "trans-boat with tail"},
+        {"xs9_178kc", "cis-boat with tail"},
+        {"xs10_69ar", "loop"},
+        {"xs10_178kk8", "beehive with tail"},
+        {"xs10_g8o652z01", "boat-tie"},
+        {"xs11_g0s453z11", "elevener"},
+        {"xs12_g8o653z11", "ship-tie"},
+        {"xs12_330fho", "trans-block on long hook"},
+        {"xs14_69bqic", "paperclip"},
+        {"xs14_g88b96z123", "big S"},
+        {"xs24_y1696z2552wgw2552zy1343", "honey farm"},
+        {"xp2_2a54", "clock"},
+        {"xp2_31ago", "bipole"},
+        {"xp2_g0k053z11", "tripole"},
+        {"xp3_co9nas0san9oczgoldlo0oldlogz1047210127401", "pulsar"},
+        {"xp15_4r4z4r4", "pentadecathlon"},
+        {"xq4_6frc", "lightweight spaceship"},
+        {"xq4_27dee6", "middleweight spaceship"},
+        {"xq4_27deee6", "heavyweight spaceship"}
+    };
+
+    unsigned strip_begin(unsigned strip, unsigned n_strips, unsigned height);
+    LiveCells extract_cells(const Grid& grid, unsigned n_threads);
+    unsigned find(std::vector<unsigned>& parent, unsigned i);
+    void unite(std::vector<unsigned>& parent, unsigned a, unsigned b);
+    void link_rows(const LiveCells& live, std::vector<unsigned>& parent, unsigned a, unsigned b);
+
+    bool oversized(const Cells& pattern);
+    Cell normalise(Cells& pattern);
+    bool same_cells(const Cells& a, const Cells& b);
+    void step(Cells& pattern);
+    std::string canonise(const Cells& pattern);
+    std::string canonise_orientation(const std::vector<bool>& bitmap, unsigned width,
+                                     unsigned length, unsigned breadth, bool transpose,
+                                     bool flip_u, bool flip_v);
+    std::string smallest(const std::string& a, const std::string& b);
+    std::string classify(Cells pattern);
+} /* unnamed namespace */
+
+std::vector<census::Object> census::take(const Grid& grid) {
+    const unsigned n_threads(thread_count());
+    const unsigned height(grid.size());
+    LiveCells live(extract_cells(grid, n_threads));
+    const unsigned n_cells(live.xs.size());
+
+    std::vector<unsigned> parent(n_cells);
+    for (unsigned i(0); i < n_cells; ++i) {
+        parent[i] = i;
+    }
+
+    // Label each strip of rows on its own. A union always hangs the larger root
+    // under the smaller one, so the threads never touch each other's cells.
+    std::vector<std::thread> workers;
+    for (unsigned t(0); t < n_threads; ++t) {
+        workers.emplace_back([&, t]() {
+            const unsigned begin(strip_begin(t, n_threads, height));
+            const unsigned end(strip_begin(t + 1, n_threads, height));
+            for (unsigned a(begin); a < end; ++a) {
+                for (unsigned b(a); b < end && b <= a + merge_distance; ++b) {
+                    link_rows(live, parent, a, b);
+                }
+            }
+            for (unsigned i(live.row_start[begin]); i < live.row_start[end]; ++i) {
+                parent[i] = parent[parent[i]];
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    workers.clear();
+
+    // Merge the objects crossing the strip boundaries
+    for (unsigned t(1); t < n_threads; ++t) {
+        const unsigned boundary(strip_begin(t, n_threads, height));
+        for (unsigned a(boundary < merge_distance ? 0 : boundary - merge_distance); a < boundary; ++a) {
+            for (unsigned b(boundary); b < height && b <= a + merge_distance; ++b) {
+                link_rows(live, parent, a, b);
+            }
+        }
+    }
+    // Roots always come first, a single pass points every cell to its root
+    std::vector<unsigned> object_of(n_cells);
+    unsigned n_objects(0);
+    for (unsigned i(0); i < n_cells; ++i) {
+        parent[i] = parent[parent[i]];
+        object_of[i] = (parent[i] == i) ? n_objects++ : object_of[parent[i]];
+    }
+
+    // Gather the cells of each object
+    std::vector<unsigned> object_start(n_objects + 1, 0);
+    for (unsigned i(0); i < n_cells; ++i) {
+        ++object_start[object_of[i] + 1];
+    }
+    for (unsigned k(0); k < n_objects; ++k) {
+        object_start[k + 1] += object_start[k];
+    }
+    Cells object_cells(n_cells);
+    std::vector<unsigned> cursor(object_start.begin(), object_start.end() - 1);
+    for (unsigned row(0); row < height; ++row) {
+        for (unsigned i(live.row_start[row]); i < live.row_start[row + 1]; ++i) {
+            object_cells[cursor[object_of[i]]++] = {(int)live.xs[i], (int)(height - 1 - row)};
+        }
+    }
+
+    // Identify the objects, most of them are the same few still lifes and
+    // oscillators so each thread remembers the ones it already met
+    std::vector<std::string> codes(n_objects);
+    for (unsigned t(0); t < n_threads; ++t) {
+        workers.emplace_back([&, t]() {
+            std::unordered_map<std::string, std::string> known;
+            const unsigned begin((uint64_t)n_objects * t / n_threads);
+            const unsigned end((uint64_t)n_objects * (t + 1) / n_threads);
+            for (unsigned k(begin); k < end; ++k) {
+                Cells pattern(object_cells.begin() + object_start[k],
+                              object_cells.begin() + object_start[k + 1]);
+                if (oversized(pattern)) {
+                    codes[k] = "ov_" + std::to_string(pattern.size());
+                    continue;
+                }
+                normalise(pattern);
+                // The coordinates fit in a byte once the pattern is normalised
+                std::string key;
+                for (auto& cell : pattern) {
+                    key += (char)cell.x;
+                    key += (char)cell.y;
+                }
+                auto it(known.find(key));
+                if (it == known.end())
+                    it = known.insert({key, classify(pattern)}).first;
+                codes[k] = it->second;
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    std::map<std::string, unsigned> tally;
+    for (auto& code : codes) {
+        ++tally[code];
+    }
+    std::vector<Object> objects;
+    for (auto& entry : tally) {
+        objects.push_back({entry.first, object_name(entry.first), entry.second});
+    }
+    std::stable_sort(objects.begin(), objects.end(), [](const Object& a, const Object& b) {
+        return a.count > b.count;
+    });
+    return objects;
+}
+
+std::vector<std::vector<Coordinates>> census::split(const std::vector<Coordinates>& cells) {
+    std::vector<std::vector<Coordinates>> objects;
+    if (cells.empty())
+        return objects;
+    std::vector<Coordinates> sorted(cells);
+    std::sort(sorted.begin(), sorted.end(), [](const Coordinates& a, const Coordinates& b) {
+        return a.y < b.y || (a.y == b.y && a.x < b.x);
+    });
+    const unsigned y_min(sorted.front().y);
+    const unsigned height(sorted.back().y - y_min + 1);
+    const unsigned n_cells(sorted.size());
+
+    LiveCells live;
+    live.row_start.resize(height + 1, 0);
+    for (auto& cell : sorted) {
+        live.xs.push_back(cell.x);
+        ++live.row_start[cell.y - y_min + 1];
+    }
+    for (unsigned i(0); i < height; ++i) {
+        live.row_start[i + 1] += live.row_start[i];
+    }
+
+    std::vector<unsigned> parent(n_cells);
+    for (unsigned i(0); i < n_cells; ++i) {
+        parent[i] = i;
+    }
+    for (unsigned a(0); a < height; ++a) {
+        for (unsigned b(a); b < height && b <= a + merge_distance; ++b) {
+            link_rows(live, parent, a, b);
+        }
+    }
+    std::vector<unsigned> object_of(n_cells);
+    for (unsigned i(0); i < n_cells; ++i) {
+        const unsigned root(find(parent, i));
+        if (root == i) {
+            object_of[i] = objects.size();
+            objects.emplace_back();
+        } else {
+            object_of[i] = object_of[root];
+        }
+        objects[object_of[i]].push_back(sorted[i]);
+    }
+    return objects;
+}
+
+std::string census::apgcode(const std::vector<Coordinates>& cells) {
+    Cells pattern;
+    for (auto& cell : cells) {
+        pattern.push_back({(int)cell.x, (int)cell.y});
+    }
+    if (pattern.empty())
+        return "";
+    normalise(pattern);
+    return classify(pattern);
+}
+
+std::vector<Coordinates> census::next_generation(const std::vector<Coordinates>& cells) {
+    Cells pattern;
+    for (auto& cell : cells) {
+        pattern.push_back({(int)cell.x, (int)cell.y});
+    }
+    step(pattern);
+    std::vector<Coordinates> next;
+    if (pattern.empty())
+        return next;
+    normalise(pattern);
+    for (auto& cell : pattern) {
+        next.push_back({(unsigned)cell.x, (unsigned)cell.y});
+    }
+    return next;
+}
+
+std::string census::object_name(std::string apgcode) {
+    auto it(object_names.find(apgcode));
+    if (it == object_names.end())
+        return "";
+    return it->second;
+}
+
+std::string census::format_table(const std::vector<Object>& objects) {
+    unsigned total(0);
+    for (auto& object : objects) {
+        total += object.count;
+    }
+
+    std::ostringstream table;
+    table << std::left << std::setw(10) << "Count" << std::setw(26) << "Name" << "apgcode\n";
+    for (auto& object : objects) {
+        table << std::setw(10) << object.count
+              << std::setw(26) << (object.name.empty() ? "-" : object.name)
+              << object.apgcode << "\n";
+    }
+    table << "\n" << total << " objects of " << objects.size() << " types\n";
+    return table.str();
+}
+
+void census::save_csv(std::string filename, const std::vector<Object>& objects) {
+    std::ofstream csv_file(filename);
+    csv_file << "apgcode,name,count\n";
+    for (auto& object : objects) {
+        csv_file << object.apgcode << "," << object.name << "," << object.count << "\n";
+    }
+}
+
+namespace {
+    unsigned strip_begin(unsigned strip, unsigned n_strips, unsigned height) {
+        return (uint64_t)height * strip / n_strips;
+    }
+
+    LiveCells extract_cells(const Grid& grid, unsigned n_threads) {
+        const unsigned height(grid.size());
+        std::vector<std::vector<unsigned>> strip_xs(n_threads);
+        std::vector<unsigned> row_size(height, 0);
+
+        std::vector<std::thread> workers;
+        for (unsigned t(0); t < n_threads; ++t) {
+            workers.emplace_back([&, t]() {
+                const unsigned end(strip_begin(t + 1, n_threads, height));
+                for (unsigned i(strip_begin(t, n_threads, height)); i < end; ++i) {
+                    for (unsigned j(0); j < grid[i].size(); ++j) {
+                        if (grid[i][j]) {
+                            strip_xs[t].push_back(j);
+                            ++row_size[i];
+                        }
+                    }
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        LiveCells live;
+        live.row_start.resize(height + 1, 0);
+        for (unsigned i(0); i < height; ++i) {
+            live.row_start[i + 1] = live.row_start[i] + row_size[i];
+        }
+        live.xs.reserve(live.row_start[height]);
+        for (auto& xs : strip_xs) {
+            live.xs.insert(live.xs.end(), xs.begin(), xs.end());
+        }
+        return live;
+    }
+
+    unsigned find(std::vector<unsigned>& parent, unsigned i) {
+        while (parent[i] != i) {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    }
+
+    void unite(std::vector<unsigned>& parent, unsigned a, unsigned b) {
+        a = find(parent, a);
+        b = find(parent, b);
+        if (a < b)
+            parent[b] = a;
+        else if (b < a)
+            parent[a] = b;
+    }
+
+    // Unite the cells of row a with the close enough cells of row b
+    void link_rows(const LiveCells& live, std::vector<unsigned>& parent, unsigned a, unsigned b) {
+        unsigned low(live.row_start[b]);
+        const unsigned end_b(live.row_start[b + 1]);
+        for (unsigned k(live.row_start[a]); k < live.row_start[a + 1]; ++k) {
+            const unsigned x(live.xs[k]);
+            while (low < end_b && live.xs[low] + merge_distance < x) {
+                ++low;
+            }
+            for (unsigned m(low); m < end_b && live.xs[m] <= x + merge_distance; ++m) {
+                if (m != k)
+                    unite(parent, k, m);
+            }
+        }
+    }
+
+    bool oversized(const Cells& pattern) {
+        Cell low(pattern.front());
+        Cell high(pattern.front());
+        for (auto& cell : pattern) {
+            low = {std::min(low.x, cell.x), std::min(low.y, cell.y)};
+            high = {std::max(high.x, cell.x), std::max(high.y, cell.y)};
+        }
+        return high.x - low.x >= (int)census_object_size_max
+               || high.y - low.y >= (int)census_object_size_max;
+    }
+
+    // Move the pattern to the origin and sort its cells row by row
+    // @return The previous position of the bounding box corner.
+    Cell normalise(Cells& pattern) {
+        Cell corner(pattern.front());
+        for (auto& cell : pattern) {
+            corner.x = std::min(corner.x, cell.x);
+            corner.y = std::min(corner.y, cell.y);
+        }
+        for (auto& cell : pattern) {
+            cell.x -= corner.x;
+            cell.y -= corner.y;
+        }
+        std::sort(pattern.begin(), pattern.end(), [](const Cell& a, const Cell& b) {
+            return a.y < b.y || (a.y == b.y && a.x < b.x);
+        });
+        return corner;
+    }
+
+    bool same_cells(const Cells& a, const Cells& b) {
+        if (a.size() != b.size())
+            return false;
+        for (unsigned i(0); i < a.size(); ++i) {
+            if (a[i].x != b[i].x || a[i].y != b[i].y)
+                return false;
+        }
+        return true;
+    }
+
+    // Evolve an isolated pattern by one generation
+    void step(Cells& pattern) {
+        if (pattern.empty())
+            return;
+        Cell low(pattern.front());
+        Cell high(pattern.front());
+        for (auto& cell : pattern) {
+            low = {std::min(low.x, cell.x), std::min(low.y, cell.y)};
+            high = {std::max(high.x, cell.x), std::max(high.y, cell.y)};
+        }
+        // One cell of margin on each side, plus one to keep the neighbourhoods inside
+        const int width(high.x - low.x + 5);
+        const int height(high.y - low.y + 5);
+        std::vector<uint8_t> count(width * height, 0);
+        std::vector<uint8_t> alive(width * height, 0);
+        for (auto& cell : pattern) {
+            const int index((cell.y - low.y + 2) * width + cell.x - low.x + 2);
+            alive[index] = 1;
+            for (int dy(-1); dy <= 1; ++dy) {
+                for (int dx(-1); dx <= 1; ++dx) {
+                    if (dx != 0 || dy != 0)
+                        ++count[index + dy * width + dx];
+                }
+            }
+        }
+        pattern.clear();
+        for (int j(1); j < height - 1; ++j) {
+            for (int i(1); i < width - 1; ++i) {
+                const uint8_t n(count[j * width + i]);
+                if (n == 3 || (n == 2 && alive[j * width + i]))
+                    pattern.push_back({i + low.x - 2, j + low.y - 2});
+            }
+        }
+    }
+
+    // @return The smallest Wechsler code of the pattern among its 8 orientations
+    std::string canonise(const Cells& pattern) {
+        unsigned width(0);
+        unsigned height(0);
+        for (auto& cell : pattern) {
+            width = std::max(width, (unsigned)cell.x + 1);
+            height = std::max(height, (unsigned)cell.y + 1);
+        }
+        std::vector<bool> bitmap(width * height, false);
+        for (auto& cell : pattern) {
+            bitmap[cell.y * width + cell.x] = true;
+        }
+
+        std::string best;
+        for (unsigned orientation(0); orientation < 8; ++orientation) {
+            const bool transpose(orientation & 4);
+            best = smallest(best, canonise_orientation(bitmap, width,
+                                                       transpose ? height : width,
+                                                       transpose ? width : height,
+                                                       transpose, orientation & 1, orientation & 2));
+        }
+        return best;
+    }
+
+    // Encode the pattern in strips of 5 rows, each column of a strip being a
+    // base 32 digit. Runs of empty columns are shortened with 'w', 'x' and 'y'.
+    std::string canonise_orientation(const std::vector<bool>& bitmap, unsigned width,
+                                     unsigned length, unsigned breadth, bool transpose,
+                                     bool flip_u, bool flip_v) {
+        std::string code;
+        for (unsigned strip(0); strip * 5 < breadth; ++strip) {
+            if (strip != 0)
+                code += 'z';
+            unsigned zeroes(0);
+            for (unsigned u(0); u < length; ++u) {
+                unsigned column(0);
+                for (unsigned w(0); w < 5 && strip * 5 + w < breadth; ++w) {
+                    const unsigned a(flip_u ? length - 1 - u : u);
+                    const unsigned b(flip_v ? breadth - 1 - strip * 5 - w : strip * 5 + w);
+                    if (transpose ? bitmap[a * width + b] : bitmap[b * width + a])
+                        column |= 1 << w;
+                }
+                if (column == 0) {
+                    ++zeroes;
+                    continue;
+                }
+                if (zeroes == 1)
+                    code += '0';
+                else if (zeroes == 2)
+                    code += 'w';
+                else if (zeroes == 3)
+                    code += 'x';
+                else if (zeroes > 3)
+                    code += std::string("y") + base32[zeroes - 4];
+                zeroes = 0;
+                code += base32[column];
+            }
+        }
+        return code;
+    }
+
+    // The shortest code wins, then the first in lexicographic order
+    std::string smallest(const std::string& a, const std::string& b) {
+        if (a.empty())
+            return b;
+        if (a.length() != b.length())
+            return a.length() < b.length() ? a : b;
+        return a < b ? a : b;
+    }
+
+    // Evolve the pattern until it comes back, at the same place or not.
+    // The code is the smallest one among all the phases.
+    std::string classify(Cells pattern) {
+        const std::string population(std::to_string(pattern.size()));
+        const Cells first(pattern);
+        Cell origin({0, 0});
+        std::string best;
+
+        for (unsigned period(1); period <= census_period_max; ++period) {
+            if (oversized(pattern))
+                return "ov_" + population;
+            best = smallest(best, canonise(pattern));
+
+            step(pattern);
+            if (pattern.empty())
+                break;
+            Cell corner(normalise(pattern));
+            origin = {origin.x + corner.x, origin.y + corner.y};
+            if (same_cells(pattern, first)) {
+                if (origin.x != 0 || origin.y != 0)
+                    return "xq" + std::to_string(period) + "_" + best;
+                if (period == 1)
+                    return "xs" + population + "_" + best;
+                return "xp" + std::to_string(period) + "_" + best;
+            }
+        }
+        return "zz_" + population;
+    }
+} /* unnamed namespace */
@@ -0,0 +1,95 @@
+/*
+ * census.h
+ * This module counts the objects left in the world once a pattern has
+ * settled. The live cells are split into objects by a parallel
+ * connected-component labeling, and each object is identified by its
+ * apgcode, the canonical code used by apgsearch and Catagolue.
+ *
+ * This file is part of GoL Lab, a simulator of Conway's game of life.
+ *
+ * Copyright (C) 2022-2023 Cyprien Lacassagne
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CENSUS_H
+#define CENSUS_H
+
+#include <string>
+#include <vector>
+#include "simulation.h"
+#include "config.h"
+
+// Objects whose bounding box exceeds this size are not canonised
+constexpr unsigned census_object_size_max(40);
+// Longest period looked for when an object is evolved on its own
+constexpr unsigned census_period_max(64);
+
+namespace census {
+    struct Object {
+        std::string apgcode;
+        std::string name;
+        unsigned count;
+    };
+
+    /**
+     * Split the live cells into objects and count them by type. Two cells
+     * belong to the same object if they are at most 2 cells apart.
+     * @param grid The world, as returned by simulation::get_state().
+     * @return One entry per type of object, sorted by decreasing count.
+     */
+    std::vector<Object> take(const Grid& grid);
+
+    /**
+     * Split a pattern into objects like take() does, on the calling thread.
+     * @param cells The live cells of the pattern.
+     * @return The live cells of each object.
+     */
+    std::vector<std::vector<Coordinates>> split(const std::vector<Coordinates>& cells);
+
+    /**
+     * Compute the apgcode of a single object.
+     * @param cells The live cells of the object.
+     * @return "xs<population>_..." for still lifes, "xp<period>_..." for oscillators,
+     * "xq<period>_..." for spaceships, "ov_<population>" for objects too large to be
+     * canonised and "zz_<population>" for objects that are not periodic.
+     */
+    std::string apgcode(const std::vector<Coordinates>& cells);
+
+    /**
+     * Evolve an isolated pattern by one generation.
+     * @param cells The live cells of the pattern.
+     * @return The live cells of the next generation, moved so that their
+     * bounding box starts at (0, 0).
+     */
+    std::vector<Coordinates> next_generation(const std::vector<Coordinates>& cells);
+
+    /**
+     * @return The common name of the object, or an empty string if it is unknown.
+     */
+    std::string object_name(std::string apgcode);
+
+    /**
+     * @return The census as a plain text table.
+     */
+    std::string format_table(const std::vector<Object>& objects);
+
+    /**
+     * Save the census as comma-separated values.
+     * @param filename CSV file to be written.
+     */
+    void save_csv(std::string filename, const std::vector<Object>& objects);
+} /* namespace census */
+
+#endif
@@ -18,6 +18,7 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <thread>
 #include "config.h"
 #ifdef _WIN32
 #  include <windows.h>
@@ -56,3 +57,8 @@ std::string working_dir() {
     return path;
 #endif /* _WIN32 */
 }
+
+unsigned thread_count() {
+    unsigned n(std::thread::hardware_concurrency());
+    return n > 0 ? n : 1;
+}
@@ -41,8 +41,32 @@ constexpr unsigned world_size_max(5000);
 constexpr unsigned world_size_min(100);
 
 constexpr unsigned cell_size(1);
+// Cells drawn beyond each edge of the visible part of the world
+constexpr unsigned view_margin(2);
+// Generations a dead cell takes to fade away, at most 15 for its age to fit in 4 bits
+constexpr unsigned fade_length(4);
+// Levels of the density pyramid, level k counting the live cells of 2^k x 2^k blocks
+constexpr unsigned density_levels(6);
+// Changes of state kept until the next drawing, beyond which every cell is drawn again
+constexpr unsigned changes_max(1 << 20);
+// Side of the squares of cells repainted when some of their cells changed
+constexpr unsigned dirty_tile_size(16);
+// Squares repainted one by one, beyond which their bounding box is repainted
+constexpr unsigned dirty_tiles_max(256);
+// Rows of the tiles of an image of the world drawn by several threads at once
+constexpr unsigned raster_tile_rows(64);
+// Cells plus pixels / 16 of an image below which a single thread draws it
+constexpr unsigned raster_parallel_min(1 << 16);
 constexpr unsigned increment_step(100);
 constexpr unsigned startup_timeout_value(20);
+// Longest period caught by the stability detection
+constexpr unsigned period_max(1024);
+// Side of the tiles of the stability map
+constexpr unsigned tile_size(16);
+// Longest period for which a tile counts as stable
+constexpr unsigned tile_period_max(15);
+// Generations a tile must keep the same period to count as stable
+constexpr unsigned tile_confirmation(2 * (tile_period_max + 1));
 
 const std::string PROGRAM_NAME("GoL Lab");
 const std::string VERSION("1.0.0");
@@ -50,6 +74,7 @@ const std::string VERSION("1.0.0");
 const std::string PATTERNS_DIR("patterns/");
 const std::string HELP_FILE("Help.txt");
 const std::string SETTINGS_INI_FILE("etc/gtk-3.0/settings.ini");
+const std::string LIBRARY_INDEX_FILE("patterns/library.idx");
 
 /**
  * @return The absolute path of the working directory (path to
@@ -57,4 +82,9 @@ const std::string SETTINGS_INI_FILE("etc/gtk-3.0/settings.ini");
  */
 std::string working_dir();
 
+/**
+ * @return The number of threads the machine can run concurrently (at least 1).
+ */
+unsigned thread_count();
+
 #endif
@@ -21,7 +21,15 @@
 #include "graphic_gui.h"
 #include "config.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
 #include <vector>
+#include <cmath>
+#include <cstdint>
 #include <iostream>
 #include <thread>
 #include <chrono>
@@ -40,12 +48,137 @@ static const std::vector<Scheme> color_scheme_table {
 };
 
 static const Cairo::RefPtr<Cairo::Context>* ptcr(nullptr);
+// Kept from one frame to the next, only reallocated when the world is resized
+static Cairo::RefPtr<Cairo::ImageSurface> heatmap_surface;
+// Version of the heat, heat_max, size and view the heatmap image was drawn for
+static std::array<unsigned long, 8> heatmap_key;
+// Premultiplied pixel of each count up to heat_palette.size() - 1, the heat_max
+// it was computed for
+static std::vector<uint32_t> heat_palette;
+static Cairo::RefPtr<Cairo::ImageSurface> density_surface;
+
+// Image of the world for the pixel renderer, one pixel per cell. The part from
+// (x_min, y_min) to (x_max, y_max), empty if x_min > x_max, shows the world
+// with the live cells in pixel.
+struct CellsImage {
+    Cairo::RefPtr<Cairo::ImageSurface> surface;
+    unsigned x_min, x_max, y_min, y_max;
+    uint32_t pixel;
+};
+// Faded cell with the pixel of its age
+struct FadedPixel {
+    unsigned x, y;
+    uint32_t pixel;
+};
+// Drawing of a cells image on the worker thread. With several threads the rows
+// in sight are cut into tiles of tile_rows rows, each drawn by a single thread:
+// the cells of tile i are sorted from cell_starts[i] to cell_starts[i + 1].
+struct RasterJob {
+    unsigned x_min, x_max, y_min, y_max;
+    uint32_t pixel;
+    std::vector<Coordinates> cells;
+    std::vector<FadedPixel> faded;
+    unsigned n_threads;
+    unsigned tile_rows;
+    std::vector<Coordinates> tiled_cells;
+    std::vector<FadedPixel> tiled_faded;
+    std::vector<size_t> cell_starts;
+    std::vector<size_t> faded_starts;
+    unsigned char* data;
+    int stride;
+};
+enum RasterState { RASTER_IDLE, RASTER_BUSY, RASTER_DONE };
+
+// The front image is painted and patched on the main thread while the worker
+// thread draws the back one. The worker hands it over by setting raster_state
+// to RASTER_DONE, the main thread then swaps them.
+static CellsImage cells_images[2] = {{nullptr, 1, 0, 1, 0, 0}, {nullptr, 1, 0, 1, 0, 0}};
+static unsigned front(0);
+static std::atomic<RasterState> raster_state(RASTER_IDLE);
+// Owned by the worker thread while raster_state is RASTER_BUSY
+static RasterJob raster_job;
+static std::mutex raster_mutex;
+static std::condition_variable raster_wakeup;
+// Both guarded by raster_mutex
+static std::function<void()> raster_done;
+static bool raster_stop(false);
+// Threads and rows of the tiles of the next images, set on the main thread
+static unsigned raster_threads(thread_count());
+static unsigned raster_rows(raster_tile_rows);
+// Threads helping the worker thread draw an image in tiles, one per core but
+// the worker's (more if more threads are asked), started with the first image
+// drawn in tiles and stopped with the program. Each batch runs task(i) for i
+// from 0 to n_tasks - 1, the worker thread and helpers 0 to helpers - 1 taking
+// the next index left until there is none.
+static struct RasterPool {
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable wakeup;
+    std::condition_variable finished;
+    // Guarded by mutex
+    unsigned long batch = 0;
+    unsigned helpers = 0;
+    unsigned running = 0;
+    bool stop = false;
+    const std::function<void(unsigned)>* task = nullptr;
+    unsigned n_tasks = 0;
+    // Taken by the threads of the batch without the mutex
+    std::atomic<unsigned> next_task{0};
+    ~RasterPool();
+} raster_pool;
+// Started with the first image, stopped and joined with the program
+static struct RasterThread {
+    std::thread thread;
+    ~RasterThread();
+} raster_thread;
+
+// Cells sorted row by row when they come unsorted, kept for its capacity
+static std::vector<Coordinates> run_cells;
+// Cells of a list in view, kept for its capacity
+static std::vector<Coordinates> view_cells;
+// Grid lines drawn once, over the whole area, for the transformation, world
+// size, color and spacing of grid_key
+static Cairo::RefPtr<Cairo::Surface> grid_surface;
+static std::array<double, 14> grid_key;
+
+// Opaque ARGB32 pixel of the live cells
+static uint32_t fg_pixel(bool dark_theme);
+// Wait for images to draw on the worker thread
+static void raster_loop();
+static void rasterize(RasterJob& job);
+// Clear the rows from y_begin to y_end - 1 in sight and draw the faded then the
+// live cells given, which lie in these rows
+static void rasterize_rows(const RasterJob& job, unsigned y_begin, unsigned y_end,
+                           const FadedPixel* faded_begin, const FadedPixel* faded_end,
+                           const Coordinates* cells_begin, const Coordinates* cells_end);
+// Sort the cells by tile into tiled, tile i from starts[i] to starts[i + 1],
+// each thread counting then moving a share of them
+template <class Cell>
+static void sort_by_tile(const RasterJob& job, unsigned n_tiles, const std::vector<Cell>& cells,
+                         std::vector<Cell>& tiled, std::vector<size_t>& starts);
+// Run task(0) to task(n_tasks - 1) on n_threads threads of the pool, the
+// calling thread included, and wait for them
+static void run_parallel(unsigned n_threads, unsigned n_tasks, const std::function<void(unsigned)>& task);
+// Wait for the batches of the pool after batch seen
+static void pool_loop(unsigned helper, unsigned long seen);
+// Shade of a cell dead for age generations, from 1 to fade_length
+static Color fade_shade(unsigned age, bool dark_theme);
+// Paint the grid, a line between cells or every step cells, from grid_surface
+static void paint_grid(double xMax, double yMax, bool dark_theme, unsigned step, int width, int height);
+// Add the cells moved by (dx, dy) to the current path, one rectangle for each
+// run of adjacent cells in a row
+static void add_cell_runs(const std::vector<Coordinates>& cells, unsigned dx, unsigned dy);
+// Gather the cells of a list sorted row by row from (x_min, y_min) to (x_max, y_max)
+// into view_cells, still sorted
+static void gather_view_cells(const std::vector<Coordinates>& cells, unsigned x_min, unsigned x_max,
+                              unsigned y_min, unsigned y_max);
 
 void graphic_set_context(const Cairo::RefPtr<Cairo::Context>& cr) {
     ptcr = &cr;
 }
 
-void graphic_draw_world(double xMax, double yMax, bool dark_theme, bool show_grid, unsigned delta) {
+void graphic_draw_world(double xMax, double yMax, bool dark_theme, bool show_grid, unsigned delta,
+                        int width, int height) {
     (*ptcr)->set_source_rgb(current_color_scheme[dark_theme].bg.r,
                             current_color_scheme[dark_theme].bg.g,
  	                        current_color_scheme[dark_theme].bg.b);                            
@@ -63,98 +196,199 @@ void graphic_draw_world(double xMax, double yMax, bool dark_theme, bool show_gri
     (*ptcr)->close_path();
     (*ptcr)->stroke();
 
-    if (show_grid && delta <= 501) {
-        double red(current_color_scheme[dark_theme].fg.r);
-        double green(current_color_scheme[dark_theme].fg.g);
-        double blue(current_color_scheme[dark_theme].fg.b);
-        (*ptcr)->set_source_rgb(ghost_color*red, ghost_color*green, ghost_color*blue);
-
-        unsigned step;
-        if (delta <= 201)
-            step = 1;
-        else if (delta <= 501)
-            step = 5;
-
-        for (double i(-0.5); i<=xMax-0.5; i+=step) {
-            if ((int)i % 5 == 0)
-                (*ptcr)->set_line_width(0.1);
-            else
-                (*ptcr)->set_line_width(0.05);
-            (*ptcr)->stroke();
-            (*ptcr)->move_to(i, -0.5);
-            (*ptcr)->line_to(i, yMax-0.5);
-        }
-        for (double j(-0.5); j<=yMax-0.5; j+=step) {
-            if ((int)j % 5 == 0)
-                (*ptcr)->set_line_width(0.1);
-            else
-                (*ptcr)->set_line_width(0.05);
-            (*ptcr)->stroke();
-            (*ptcr)->move_to(-0.5, j);
-            (*ptcr)->line_to(xMax-0.5, j);
-        }
-        (*ptcr)->stroke();
-    }
+    if (show_grid && delta <= 501)
+        paint_grid(xMax, yMax, dark_theme, delta <= 201 ? 1 : 5, width, height);
 }
 
-void graphic_draw_cell(unsigned x, unsigned y, bool dark_theme) {
-    (*ptcr)->set_source_rgb(current_color_scheme[dark_theme].fg.r,
-                            current_color_scheme[dark_theme].fg.g,
-                            current_color_scheme[dark_theme].fg.b);
-    (*ptcr)->set_line_width(0.0001);
+void graphic_draw_cells(const std::vector<Coordinates>& cells, bool dark_theme) {
+    graphic_draw_cells(cells, current_color_scheme[dark_theme].fg);
+}
 
-    (*ptcr)->move_to(x - cell_size/2., y - cell_size/2.);
-    (*ptcr)->line_to(x - cell_size/2., y + cell_size/2.);
-    (*ptcr)->line_to(x + cell_size/2., y + cell_size/2.);
-    (*ptcr)->line_to(x + cell_size/2., y - cell_size/2.);
+void graphic_draw_cells(const std::vector<Coordinates>& cells, const Color color) {
+    if (cells.empty())
+        return;
+    add_cell_runs(cells, 0, 0);
+    (*ptcr)->set_source_rgb(color.r, color.g, color.b);
+    (*ptcr)->fill();
+}
 
-    (*ptcr)->close_path();
-    (*ptcr)->fill_preserve();
-    (*ptcr)->stroke();
+void graphic_draw_faded_cells(const std::vector<Coordinates>& cells, const std::vector<uint8_t>& ages,
+                              bool dark_theme) {
+    // One path per age, the lists are kept for their capacity
+    static std::array<std::vector<Coordinates>, fade_length + 1> by_age;
+    for (auto& list : by_age) {
+        list.clear();
+    }
+    for (size_t i(0); i < cells.size(); ++i) {
+        by_age[ages[i]].push_back(cells[i]);
+    }
+    for (unsigned age(1); age <= fade_length; ++age) {
+        graphic_draw_cells(by_age[age], fade_shade(age, dark_theme));
+    }
 }
 
-void graphic_draw_cell(unsigned x, unsigned y, const Color override_color) {
-    (*ptcr)->set_source_rgb(override_color.r, override_color.g, override_color.b);
-    (*ptcr)->set_line_width(0.0001);
+void graphic_rasterize_cells_image(const std::vector<Coordinates>& cells, unsigned width,
+                                   unsigned height, unsigned x_min, unsigned x_max,
+                                   unsigned y_min, unsigned y_max, bool dark_theme,
+                                   const std::vector<Coordinates>& faded,
+                                   const std::vector<uint8_t>& ages) {
+    if (graphic_cells_image_busy())
+        return;
+    CellsImage& back(cells_images[1 - front]);
+    if (!back.surface || back.surface->get_width() != (int)width
+        || back.surface->get_height() != (int)height)
+        back.surface = Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32, width, height);
+    back = {back.surface, x_min, x_max, y_min, y_max, fg_pixel(dark_theme)};
+
+    // The cells are copied, the simulation goes on meanwhile
+    back.surface->flush();
+    raster_job.cells.assign(cells.begin(), cells.end());
+    std::array<uint32_t, fade_length + 1> palette;
+    for (unsigned age(1); age <= fade_length; ++age) {
+        const Color shade(fade_shade(age, dark_theme));
+        palette[age] = 0xffu << 24 | (uint32_t)(shade.r * 255) << 16
+                       | (uint32_t)(shade.g * 255) << 8 | (uint32_t)(shade.b * 255);
+    }
+    raster_job.faded.resize(faded.size());
+    for (size_t i(0); i < faded.size(); ++i) {
+        raster_job.faded[i] = {faded[i].x, faded[i].y, palette[ages[i]]};
+    }
+    raster_job.n_threads = raster_threads;
+    raster_job.tile_rows = raster_rows;
+    raster_job.x_min = x_min;
+    raster_job.x_max = x_max;
+    raster_job.y_min = y_min;
+    raster_job.y_max = y_max;
+    raster_job.pixel = back.pixel;
+    raster_job.data = back.surface->get_data();
+    raster_job.stride = back.surface->get_stride();
+    {
+        std::lock_guard<std::mutex> lock(raster_mutex);
+        raster_state = RASTER_BUSY;
+        if (!raster_thread.thread.joinable())
+            raster_thread.thread = std::thread(raster_loop);
+    }
+    raster_wakeup.notify_one();
+}
 
-    (*ptcr)->move_to(x - cell_size/2., y - cell_size/2.);
-    (*ptcr)->line_to(x - cell_size/2., y + cell_size/2.);
-    (*ptcr)->line_to(x + cell_size/2., y + cell_size/2.);
-    (*ptcr)->line_to(x + cell_size/2., y - cell_size/2.);
+bool graphic_cells_image_busy() {
+    if (raster_state == RASTER_DONE) {
+        front = 1 - front;
+        cells_images[front].surface->mark_dirty();
+        raster_state = RASTER_IDLE;
+    }
+    return raster_state == RASTER_BUSY;
+}
 
-    (*ptcr)->close_path();
-    (*ptcr)->fill_preserve();
-    (*ptcr)->stroke();
+void graphic_set_raster_tiling(unsigned n_threads, unsigned tile_rows) {
+    raster_threads = std::max(1u, n_threads);
+    raster_rows = std::max(1u, tile_rows);
 }
 
-void graphic_fade_dead(unsigned x, unsigned y, const Color gray) {
+void graphic_on_cells_image_done(std::function<void()> callback) {
+    std::lock_guard<std::mutex> lock(raster_mutex);
+    raster_done = callback;
+}
 
-    (*ptcr)->set_source_rgb(gray.r, gray.g, gray.b);
-    (*ptcr)->set_line_width(0.0001);
+bool graphic_cells_image_exact(unsigned width, unsigned height, unsigned x_min, unsigned x_max,
+                               unsigned y_min, unsigned y_max, bool dark_theme) {
+    const CellsImage& image(cells_images[front]);
+    if (!image.surface || image.surface->get_width() != (int)width
+        || image.surface->get_height() != (int)height)
+        return false;
+    if (image.pixel != fg_pixel(dark_theme))
+        return false;
+    return x_min > x_max || y_min > y_max
+           || (image.x_min <= x_min && x_max <= image.x_max
+               && image.y_min <= y_min && y_max <= image.y_max);
+}
 
-    (*ptcr)->move_to(x - cell_size/2., y - cell_size/2.);
-    (*ptcr)->line_to(x - cell_size/2., y + cell_size/2.);
-    (*ptcr)->line_to(x + cell_size/2., y + cell_size/2.);
-    (*ptcr)->line_to(x + cell_size/2., y - cell_size/2.);
+void graphic_update_cells_image(const std::vector<Coordinates>& born,
+                                const std::vector<Coordinates>& died) {
+    const CellsImage& image(cells_images[front]);
+    if (!image.surface || (born.empty() && died.empty()))
+        return;
+    image.surface->flush();
+    unsigned char* data(image.surface->get_data());
+    const int stride(image.surface->get_stride());
+    for (auto& cell : born) {
+        ((uint32_t*)(data + cell.y * stride))[cell.x] = image.pixel;
+    }
+    for (auto& cell : died) {
+        ((uint32_t*)(data + cell.y * stride))[cell.x] = 0;
+    }
+    image.surface->mark_dirty();
+}
 
-    (*ptcr)->close_path();
-    (*ptcr)->fill_preserve();
-    (*ptcr)->stroke();
+void graphic_paint_cells_image(unsigned x_min, unsigned x_max, unsigned y_min, unsigned y_max) {
+    // Only the part showing the world, the rest of the image is stale
+    const CellsImage& image(cells_images[front]);
+    x_min = std::max(x_min, image.x_min);
+    x_max = std::min(x_max, image.x_max);
+    y_min = std::max(y_min, image.y_min);
+    y_max = std::min(y_max, image.y_max);
+    if (!image.surface || x_min > x_max || y_min > y_max)
+        return;
+    (*ptcr)->save();
+    (*ptcr)->translate(-cell_size/2., -cell_size/2.);
+    auto pattern(Cairo::SurfacePattern::create(image.surface));
+    pattern->set_filter(Cairo::FILTER_NEAREST);
+    (*ptcr)->set_source(pattern);
+    (*ptcr)->rectangle(x_min, y_min, x_max - x_min + 1, y_max - y_min + 1);
+    (*ptcr)->fill();
+    (*ptcr)->restore();
 }
 
-void graphic_ghost_pattern(unsigned x, unsigned y, 
-                           std::vector<Coordinates> cells, bool dark_theme) {
-    (*ptcr)->move_to(x, y);
-    if (current_color_scheme[dark_theme].bg.r >= 0.5) {
-        for (auto& e : cells) {
-            graphic_draw_cell(x + e.x, y + e.y, blue);
-        }
-    }else {
-        for (auto& e : cells) {
-            graphic_draw_cell(x + e.x, y + e.y, yellow);
+void graphic_draw_density_image(const std::vector<uint16_t>& counts, unsigned width, unsigned height,
+                                unsigned level, unsigned x_min, unsigned x_max,
+                                unsigned y_min, unsigned y_max, bool dark_theme) {
+    if (!density_surface || density_surface->get_width() != (int)width
+        || density_surface->get_height() != (int)height)
+        density_surface = Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32, width, height);
+    if (x_min > x_max || y_min > y_max)
+        return;
+
+    // Premultiplied pixel of each possible count
+    const Color fg(current_color_scheme[dark_theme].fg);
+    const unsigned full(1u << 2 * level);
+    std::vector<uint32_t> palette(full + 1);
+    for (unsigned count(0); count <= full; ++count) {
+        const double alpha((double)count / full);
+        palette[count] = (uint32_t)(alpha * 255) << 24 | (uint32_t)(alpha * fg.r * 255) << 16
+                         | (uint32_t)(alpha * fg.g * 255) << 8 | (uint32_t)(alpha * fg.b * 255);
+    }
+    density_surface->flush();
+    unsigned char* data(density_surface->get_data());
+    const int stride(density_surface->get_stride());
+    for (unsigned y(y_min); y <= y_max; ++y) {
+        uint32_t* row((uint32_t*)(data + y * stride));
+        const uint16_t* count(counts.data() + y * width);
+        for (unsigned x(x_min); x <= x_max; ++x) {
+            row[x] = palette[count[x]];
         }
     }
-    (*ptcr)->stroke();
+    density_surface->mark_dirty(x_min, y_min, x_max - x_min + 1, y_max - y_min + 1);
+
+    // Block (i, j) covers the cells from (i, j) * 2^level, each centred on its coordinates
+    (*ptcr)->save();
+    (*ptcr)->translate(-cell_size/2., -cell_size/2.);
+    (*ptcr)->scale(1 << level, 1 << level);
+    auto pattern(Cairo::SurfacePattern::create(density_surface));
+    pattern->set_filter(Cairo::FILTER_NEAREST);
+    (*ptcr)->set_source(pattern);
+    (*ptcr)->rectangle(x_min, y_min, x_max - x_min + 1, y_max - y_min + 1);
+    (*ptcr)->fill();
+    (*ptcr)->restore();
+}
+
+void graphic_ghost_pattern(unsigned x, unsigned y, 
+                           std::vector<Coordinates> cells, bool dark_theme) {
+    if (cells.empty())
+        return;
+    add_cell_runs(cells, x, y);
+    const Color color(current_color_scheme[dark_theme].bg.r >= 0.5 ? blue : yellow);
+    (*ptcr)->set_source_rgb(color.r, color.g, color.b);
+    (*ptcr)->fill();
 }
 
 void graphic_draw_select_rec(unsigned x_0, unsigned y_0, unsigned x, 
@@ -192,12 +426,161 @@ void graphic_draw_select_rec(unsigned x_0, unsigned y_0, unsigned x,
 }
 
 void graphic_highlight_selected_cells(std::vector<Coordinates> selected_cells, bool dark_theme) {
-    const Color current_fg(current_color_scheme[dark_theme].fg);
-    const Color current_bg(current_color_scheme[dark_theme].bg);
+    graphic_draw_cells(selected_cells, current_color_scheme[dark_theme].highlight);
+}
+
+void graphic_draw_heatmap(const std::vector<uint16_t>& heat, unsigned width, unsigned height,
+                          uint16_t heat_max, unsigned long version, unsigned x_min,
+                          unsigned x_max, unsigned y_min, unsigned y_max) {
+    if (heat_max == 0 || x_min > x_max || y_min > y_max)
+        return;
+    if (!heatmap_surface || heatmap_surface->get_width() != (int)width
+        || heatmap_surface->get_height() != (int)height)
+        heatmap_surface = Cairo::ImageSurface::create(Cairo::FORMAT_ARGB32, width, height);
+
+    const std::array<unsigned long, 8> key({version, heat_max, width, height,
+                                            x_min, x_max, y_min, y_max});
+    if (key != heatmap_key) {
+        heatmap_key = key;
+        // Cold cells are blue, hot cells are red and more opaque. The scale is
+        // logarithmic so that the few hottest cells do not hide the rest.
+        if (heat_palette.size() != heat_max + 1u) {
+            heat_palette.assign(heat_max + 1, 0);
+            const double scale(1 / std::log1p(heat_max));
+            for (unsigned count(1); count <= heat_max; ++count) {
+                const double t(std::log1p(count) * scale);
+                const double alpha(0.3 + 0.5 * t);
+                // Premultiplied ARGB
+                const uint32_t a(alpha * 255);
+                const uint32_t r(alpha * t * 255);
+                const uint32_t g(alpha * 4 * t * (1 - t) * 255);
+                const uint32_t b(alpha * (1 - t) * 255);
+                heat_palette[count] = a << 24 | r << 16 | g << 8 | b;
+            }
+        }
+        // Only the part in view, the rest of the image is not painted
+        heatmap_surface->flush();
+        unsigned char* data(heatmap_surface->get_data());
+        const int stride(heatmap_surface->get_stride());
+        for (unsigned y(y_min); y <= y_max; ++y) {
+            // The y axis points up, so image row y is drawn at cell row y
+            uint32_t* row((uint32_t*)(data + y * stride));
+            const uint16_t* counts(heat.data() + y * width);
+            for (unsigned x(x_min); x <= x_max; ++x) {
+                row[x] = heat_palette[counts[x]];
+            }
+        }
+        heatmap_surface->mark_dirty();
+    }
+
+    (*ptcr)->save();
+    (*ptcr)->translate(-cell_size/2., -cell_size/2.);
+    auto pattern(Cairo::SurfacePattern::create(heatmap_surface));
+    pattern->set_filter(Cairo::FILTER_NEAREST);
+    (*ptcr)->set_source(pattern);
+    (*ptcr)->rectangle(x_min, y_min, x_max - x_min + 1, y_max - y_min + 1);
+    (*ptcr)->fill();
+    (*ptcr)->restore();
+}
+
+void graphic_draw_diff(const std::vector<Coordinates>& added, const std::vector<Coordinates>& removed,
+                       unsigned x_min, unsigned x_max, unsigned y_min, unsigned y_max) {
+    gather_view_cells(added, x_min, x_max, y_min, y_max);
+    graphic_draw_cells(view_cells, Color{0.0, 0.7, 0.2});
+    gather_view_cells(removed, x_min, x_max, y_min, y_max);
+    graphic_draw_cells(view_cells, Color{0.9, 0.1, 0.1});
+}
+
+void graphic_draw_stability_map(const std::vector<TileState>& states, unsigned tiles_x) {
+    // One path per state, filled at once
+    const struct {
+        TileState state;
+        Color color;
+        double alpha;
+    } layers[] = {{TILE_OSCILLATING, {0.1, 0.7, 0.3}, 0.2}, {TILE_ACTIVE, {0.9, 0.2, 0.1}, 0.35}};
+
+    for (auto& layer : layers) {
+        for (unsigned index(0); index < states.size(); ++index) {
+            if (states[index] != layer.state)
+                continue;
+            (*ptcr)->rectangle((index % tiles_x) * tile_size - cell_size/2.,
+                               (index / tiles_x) * tile_size - cell_size/2.,
+                               tile_size, tile_size);
+        }
+        (*ptcr)->set_source_rgba(layer.color.r, layer.color.g, layer.color.b, layer.alpha);
+        (*ptcr)->fill();
+    }
+}
+
+void graphic_draw_time_series(const std::vector<Bucket>& buckets, double width, double height,
+                              bool dark_theme) {
+    const Color fg(current_color_scheme[dark_theme].fg);
+    const Color bg(current_color_scheme[dark_theme].bg);
+    (*ptcr)->set_source_rgb(bg.r, bg.g, bg.b);
+    (*ptcr)->paint();
+    if (buckets.empty())
+        return;
 
-    for (auto& e : selected_cells) {
-        graphic_draw_cell(e.x, e.y, {current_color_scheme[dark_theme].highlight});
+    unsigned population_max(1);
+    unsigned change_max(1);
+    for (auto& bucket : buckets) {
+        population_max = std::max(population_max, bucket.population.max);
+        change_max = std::max(change_max, std::max(bucket.births.max, bucket.deaths.max));
     }
+
+    // The population takes the upper two thirds, the births and deaths the rest
+    const double margin(20);
+    const double split(height * 2 / 3);
+    const double step((width - 2 * margin) / buckets.size());
+    auto x_of([&](unsigned i) { return margin + (i + 0.5) * step; });
+    auto population_y([&](double value) {
+        return split - margin / 2 - value / population_max * (split - 1.5 * margin);
+    });
+    auto change_y([&](double value) {
+        return height - margin / 2 - value / change_max * (height - split - margin);
+    });
+
+    // Band between the smallest and largest population of each bucket
+    (*ptcr)->set_source_rgba(fg.r, fg.g, fg.b, 0.25);
+    (*ptcr)->move_to(x_of(0), population_y(buckets[0].population.max));
+    for (unsigned i(1); i < buckets.size(); ++i) {
+        (*ptcr)->line_to(x_of(i), population_y(buckets[i].population.max));
+    }
+    for (unsigned i(buckets.size()); i-- > 0;) {
+        (*ptcr)->line_to(x_of(i), population_y(buckets[i].population.min));
+    }
+    (*ptcr)->close_path();
+    (*ptcr)->fill();
+
+    (*ptcr)->set_line_width(1);
+    (*ptcr)->set_source_rgb(fg.r, fg.g, fg.b);
+    for (unsigned i(0); i < buckets.size(); ++i) {
+        (*ptcr)->line_to(x_of(i), population_y(buckets[i].population.mean));
+    }
+    (*ptcr)->stroke();
+
+    (*ptcr)->set_source_rgb(0.0, 0.6, 0.3);
+    for (unsigned i(0); i < buckets.size(); ++i) {
+        (*ptcr)->line_to(x_of(i), change_y(buckets[i].births.mean));
+    }
+    (*ptcr)->stroke();
+    (*ptcr)->set_source_rgb(0.8, 0.2, 0.2);
+    for (unsigned i(0); i < buckets.size(); ++i) {
+        (*ptcr)->line_to(x_of(i), change_y(buckets[i].deaths.mean));
+    }
+    (*ptcr)->stroke();
+
+    const Bucket& last(buckets.back());
+    (*ptcr)->set_source_rgb(fg.r, fg.g, fg.b);
+    (*ptcr)->set_font_size(11);
+    (*ptcr)->move_to(margin, margin);
+    (*ptcr)->show_text("Population (max " + std::to_string(population_max) + ")");
+    (*ptcr)->move_to(margin, split + margin / 2);
+    (*ptcr)->show_text("Births and deaths (max " + std::to_string(change_max) + ")");
+    (*ptcr)->move_to(width / 2, margin);
+    (*ptcr)->show_text("Generations " + std::to_string(buckets.front().first_generation) + " to "
+                       + std::to_string(last.first_generation + last.n_generations - 1)
+                       + ", " + std::to_string(last.n_generations) + " per point");
 }
 
 void graphic_change_light_color_scheme(unsigned id) {
@@ -207,3 +590,259 @@ void graphic_change_light_color_scheme(unsigned id) {
 void graphic_change_dark_color_scheme(unsigned id) {
     current_color_scheme[1] = color_scheme_table[id];
 }
+
+static uint32_t fg_pixel(bool dark_theme) {
+    const Color fg(current_color_scheme[dark_theme].fg);
+    return 0xffu << 24 | (uint32_t)(fg.r * 255) << 16 | (uint32_t)(fg.g * 255) << 8
+           | (uint32_t)(fg.b * 255);
+}
+
+static void add_cell_runs(const std::vector<Coordinates>& cells, unsigned dx, unsigned dy) {
+    const auto row_order([](const Coordinates& a, const Coordinates& b) {
+        return a.y < b.y || (a.y == b.y && a.x < b.x);
+    });
+    const std::vector<Coordinates>* sorted(&cells);
+    if (!std::is_sorted(cells.begin(), cells.end(), row_order)) {
+        run_cells.assign(cells.begin(), cells.end());
+        std::sort(run_cells.begin(), run_cells.end(), row_order);
+        sorted = &run_cells;
+    }
+    for (size_t first(0), last(0); first < sorted->size(); first = ++last) {
+        const Coordinates& start((*sorted)[first]);
+        // Repeated cells do not break a run
+        while (last + 1 < sorted->size() && (*sorted)[last + 1].y == start.y
+               && (*sorted)[last + 1].x <= (*sorted)[last].x + 1) {
+            ++last;
+        }
+        (*ptcr)->rectangle(start.x + dx - cell_size/2., start.y + dy - cell_size/2.,
+                           ((*sorted)[last].x - start.x + 1) * cell_size, cell_size);
+    }
+}
+
+static void gather_view_cells(const std::vector<Coordinates>& cells, unsigned x_min, unsigned x_max,
+                              unsigned y_min, unsigned y_max) {
+    view_cells.clear();
+    // The rows in view follow each other in the list
+    auto it(std::lower_bound(cells.begin(), cells.end(), y_min,
+                             [](const Coordinates& cell, unsigned y) { return cell.y < y; }));
+    for (; it != cells.end() && it->y <= y_max; ++it) {
+        if (it->x >= x_min && it->x <= x_max)
+            view_cells.push_back(*it);
+    }
+}
+
+static void paint_grid(double xMax, double yMax, bool dark_theme, unsigned step, int width, int height) {
+    Cairo::Matrix matrix;
+    (*ptcr)->get_matrix(matrix);
+    const Color fg(current_color_scheme[dark_theme].fg);
+    const std::array<double, 14> key{{matrix.xx, matrix.yx, matrix.xy, matrix.yy, matrix.x0, matrix.y0,
+                                      xMax, yMax, fg.r, fg.g, fg.b, (double)step,
+                                      (double)width, (double)height}};
+    if (!grid_surface || key != grid_key) {
+        grid_surface = Cairo::Surface::create((*ptcr)->get_target(), Cairo::CONTENT_COLOR_ALPHA,
+                                              width, height);
+        auto cr(Cairo::Context::create(grid_surface));
+        cr->set_matrix(matrix);
+        cr->set_source_rgb(ghost_color*fg.r, ghost_color*fg.g, ghost_color*fg.b);
+        // With a line between every two cells, every fifth line is thicker
+        for (bool thick : {false, true}) {
+            for (unsigned k(0); k * step <= xMax; ++k) {
+                if ((step == 1 && k % 5 == 0) == thick) {
+                    cr->move_to(k * step - 0.5, -0.5);
+                    cr->line_to(k * step - 0.5, yMax-0.5);
+                }
+            }
+            for (unsigned k(0); k * step <= yMax; ++k) {
+                if ((step == 1 && k % 5 == 0) == thick) {
+                    cr->move_to(-0.5, k * step - 0.5);
+                    cr->line_to(xMax-0.5, k * step - 0.5);
+                }
+            }
+            cr->set_line_width(thick ? 0.1 : 0.05);
+            cr->stroke();
+        }
+        grid_key = key;
+    }
+    // The matrix of the drawing area starts from the identity, which maps
+    // the surface onto the area
+    (*ptcr)->save();
+    (*ptcr)->set_identity_matrix();
+    (*ptcr)->set_source(grid_surface, 0, 0);
+    (*ptcr)->paint();
+    (*ptcr)->restore();
+}
+
+static Color fade_shade(unsigned age, bool dark_theme) {
+    // Mirrored on a light theme, from the darkest to the lightest
+    if (!dark_theme)
+        return fade_shade(fade_length + 1 - age, true);
+    // Spread over the generations of fading, whatever their number
+    const Color stops[] = {gray1, gray2, gray3, gray4};
+    const double position(fade_length > 1 ? 3. * (age - 1) / (fade_length - 1) : 0);
+    const unsigned stop(std::min(2u, (unsigned)position));
+    const double t(position - stop);
+    return {stops[stop].r + t * (stops[stop + 1].r - stops[stop].r),
+            stops[stop].g + t * (stops[stop + 1].g - stops[stop].g),
+            stops[stop].b + t * (stops[stop + 1].b - stops[stop].b)};
+}
+
+RasterPool::~RasterPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    wakeup.notify_all();
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+RasterThread::~RasterThread() {
+    if (!thread.joinable())
+        return;
+    {
+        std::lock_guard<std::mutex> lock(raster_mutex);
+        raster_stop = true;
+    }
+    raster_wakeup.notify_one();
+    thread.join();
+}
+
+static void raster_loop() {
+    std::unique_lock<std::mutex> lock(raster_mutex);
+    while (true) {
+        raster_wakeup.wait(lock, []() { return raster_stop || raster_state == RASTER_BUSY; });
+        if (raster_stop)
+            return;
+        lock.unlock();
+        rasterize(raster_job);
+        lock.lock();
+        raster_state = RASTER_DONE;
+        if (raster_done)
+            raster_done();
+    }
+}
+
+static void rasterize(RasterJob& job) {
+    if (job.x_min > job.x_max || job.y_min > job.y_max)
+        return;
+    const unsigned n_tiles((job.y_max - job.y_min) / job.tile_rows + 1);
+    const size_t size(job.cells.size() + job.faded.size()
+                      + (size_t)(job.x_max - job.x_min + 1) * (job.y_max - job.y_min + 1) / 16);
+    const unsigned n_threads(size < raster_parallel_min ? 1 : std::min(job.n_threads, n_tiles));
+    if (n_threads == 1) {
+        rasterize_rows(job, job.y_min, job.y_max + 1, job.faded.data(),
+                       job.faded.data() + job.faded.size(), job.cells.data(),
+                       job.cells.data() + job.cells.size());
+        return;
+    }
+    job.n_threads = n_threads;
+    sort_by_tile(job, n_tiles, job.faded, job.tiled_faded, job.faded_starts);
+    sort_by_tile(job, n_tiles, job.cells, job.tiled_cells, job.cell_starts);
+    // Each tile owns its rows of the surface
+    run_parallel(n_threads, n_tiles, [&](unsigned tile) {
+        const unsigned y_begin(job.y_min + tile * job.tile_rows);
+        rasterize_rows(job, y_begin, std::min(job.y_max + 1, y_begin + job.tile_rows),
+                       job.tiled_faded.data() + job.faded_starts[tile],
+                       job.tiled_faded.data() + job.faded_starts[tile + 1],
+                       job.tiled_cells.data() + job.cell_starts[tile],
+                       job.tiled_cells.data() + job.cell_starts[tile + 1]);
+    });
+}
+
+static void rasterize_rows(const RasterJob& job, unsigned y_begin, unsigned y_end,
+                           const FadedPixel* faded_begin, const FadedPixel* faded_end,
+                           const Coordinates* cells_begin, const Coordinates* cells_end) {
+    // The dead cells are transparent, the world and the grid show through.
+    // The faded cells are drawn under the live ones.
+    for (unsigned y(y_begin); y < y_end; ++y) {
+        uint32_t* row((uint32_t*)(job.data + y * job.stride));
+        std::fill(row + job.x_min, row + job.x_max + 1, 0);
+    }
+    for (const FadedPixel* cell(faded_begin); cell != faded_end; ++cell) {
+        ((uint32_t*)(job.data + cell->y * job.stride))[cell->x] = cell->pixel;
+    }
+    for (const Coordinates* cell(cells_begin); cell != cells_end; ++cell) {
+        // As for the heatmap, image row y is drawn at cell row y
+        ((uint32_t*)(job.data + cell->y * job.stride))[cell->x] = job.pixel;
+    }
+}
+
+template <class Cell>
+static void sort_by_tile(const RasterJob& job, unsigned n_tiles, const std::vector<Cell>& cells,
+                         std::vector<Cell>& tiled, std::vector<size_t>& starts) {
+    // Share t of the cells goes from t * share on, its cells of tile i are
+    // counted then moved from places[t * n_tiles + i] on
+    const unsigned n_threads(job.n_threads);
+    const size_t share((cells.size() + n_threads - 1) / n_threads);
+    std::vector<size_t> places((size_t)n_threads * n_tiles, 0);
+    run_parallel(n_threads, n_threads, [&](unsigned t) {
+        size_t* counts(places.data() + (size_t)t * n_tiles);
+        const size_t end(std::min(cells.size(), (t + 1) * share));
+        for (size_t i(t * share); i < end; ++i) {
+            ++counts[(cells[i].y - job.y_min) / job.tile_rows];
+        }
+    });
+    // The tiles follow each other, the shares of a tile too
+    starts.resize(n_tiles + 1);
+    size_t place(0);
+    for (unsigned tile(0); tile < n_tiles; ++tile) {
+        starts[tile] = place;
+        for (unsigned t(0); t < n_threads; ++t) {
+            const size_t count(places[(size_t)t * n_tiles + tile]);
+            places[(size_t)t * n_tiles + tile] = place;
+            place += count;
+        }
+    }
+    starts[n_tiles] = place;
+    tiled.resize(cells.size());
+    run_parallel(n_threads, n_threads, [&](unsigned t) {
+        size_t* next(places.data() + (size_t)t * n_tiles);
+        const size_t end(std::min(cells.size(), (t + 1) * share));
+        for (size_t i(t * share); i < end; ++i) {
+            tiled[next[(cells[i].y - job.y_min) / job.tile_rows]++] = cells[i];
+        }
+    });
+}
+
+static void run_parallel(unsigned n_threads, unsigned n_tasks, const std::function<void(unsigned)>& task) {
+    std::unique_lock<std::mutex> lock(raster_pool.mutex);
+    while (raster_pool.threads.size() + 1 < std::max(n_threads, thread_count())) {
+        raster_pool.threads.emplace_back(pool_loop, raster_pool.threads.size(), raster_pool.batch);
+    }
+    raster_pool.task = &task;
+    raster_pool.n_tasks = n_tasks;
+    raster_pool.next_task = 0;
+    raster_pool.helpers = n_threads - 1;
+    raster_pool.running = n_threads - 1;
+    ++raster_pool.batch;
+    lock.unlock();
+    raster_pool.wakeup.notify_all();
+    for (unsigned i(raster_pool.next_task++); i < n_tasks; i = raster_pool.next_task++) {
+        task(i);
+    }
+    lock.lock();
+    raster_pool.finished.wait(lock, []() { return raster_pool.running == 0; });
+}
+
+static void pool_loop(unsigned helper, unsigned long seen) {
+    std::unique_lock<std::mutex> lock(raster_pool.mutex);
+    while (true) {
+        raster_pool.wakeup.wait(lock, [&]() { return raster_pool.stop || raster_pool.batch != seen; });
+        if (raster_pool.stop)
+            return;
+        // A helper taking part holds up the next batch, it cannot miss it
+        seen = raster_pool.batch;
+        if (helper >= raster_pool.helpers)
+            continue;
+        const std::function<void(unsigned)>& task(*raster_pool.task);
+        const unsigned n_tasks(raster_pool.n_tasks);
+        lock.unlock();
+        for (unsigned i(raster_pool.next_task++); i < n_tasks; i = raster_pool.next_task++) {
+            task(i);
+        }
+        lock.lock();
+        if (--raster_pool.running == 0)
+            raster_pool.finished.notify_one();
+    }
+}
@@ -25,8 +25,11 @@
 #ifndef GRAPHIC_H
 #define GRAPHIC_H
 
+#include <cstdint>
+#include <functional>
 #include <vector>
 #include "config.h"
+#include "timeseries.h"
 
 struct Color {
     double r;
@@ -34,6 +37,8 @@ struct Color {
     double b;
 };
 
+enum TileState { TILE_SETTLED, TILE_OSCILLATING, TILE_ACTIVE };
+
 struct Scheme {
     Color fg;
     Color bg;
@@ -64,13 +69,104 @@ constexpr Scheme Asphalt({gray, black, {0.5, 0.0, 0.2}});
 constexpr Scheme Albaster({black, gray1, {0.0, 0.6, 0.3}});
 constexpr Scheme DeepBlue({gray2, night_blue, {0.65, 0.05, 0.35}});
 
-void graphic_draw_world(double xMax, double yMax, bool ref_color, bool show_grid, unsigned delta);
-void graphic_draw_cell(unsigned x, unsigned y, bool ref_color);
-void graphic_draw_cell(unsigned x, unsigned y, const Color);
-void graphic_fade_dead(unsigned x, unsigned y, const Color gray);
+/**
+ * Draw the background and the border of the world, and the grid if shown.
+ * The grid is drawn once into a surface of width x height pixels, then only
+ * painted from it until the frame, the colors or the world size change.
+ */
+void graphic_draw_world(double xMax, double yMax, bool ref_color, bool show_grid, unsigned delta,
+                        int width, int height);
+/**
+ * Draw the cells in the color of the live cells, or in the given color, as
+ * one path filled at once: each run of adjacent cells in a row is a single
+ * rectangle.
+ */
+void graphic_draw_cells(const std::vector<Coordinates>& cells, bool ref_color);
+void graphic_draw_cells(const std::vector<Coordinates>& cells, const Color);
+/**
+ * Draw the cells dead for ages[i] generations out of fade_length, in shades
+ * of gray lighter and lighter with the age on a light theme, darker and
+ * darker on a dark theme.
+ */
+void graphic_draw_faded_cells(const std::vector<Coordinates>& cells, const std::vector<uint8_t>& ages,
+                              bool dark_theme);
+/**
+ * Start drawing an image of the world, one pixel per cell, on a worker thread.
+ * The cells are copied first. Only the part of the image from (x_min, y_min)
+ * to (x_max, y_max) is drawn. Nothing is done if the worker thread is busy.
+ * @param faded Cells fading away under the live cells, in the shade of their
+ * age given at the same index in ages.
+ */
+void graphic_rasterize_cells_image(const std::vector<Coordinates>& cells, unsigned width,
+                                   unsigned height, unsigned x_min, unsigned x_max,
+                                   unsigned y_min, unsigned y_max, bool dark_theme,
+                                   const std::vector<Coordinates>& faded,
+                                   const std::vector<uint8_t>& ages);
+/**
+ * Hand over the image drawn by the worker thread if it is finished, it then
+ * replaces the one painted and patched by the functions below.
+ * @return Whether the worker thread is still drawing.
+ */
+bool graphic_cells_image_busy();
+/**
+ * Set how the next images are drawn: the rows in sight are cut into tiles of
+ * tile_rows rows, drawn by n_threads threads at once (thread_count() threads
+ * and tiles of raster_tile_rows rows by default). Small images are drawn by a
+ * single thread.
+ */
+void graphic_set_raster_tiling(unsigned n_threads, unsigned tile_rows);
+/**
+ * Set the function called, from the worker thread, when an image is finished.
+ */
+void graphic_on_cells_image_done(std::function<void()> callback);
+/**
+ * @return Whether the image of the world drawn by graphic_rasterize_cells_image()
+ * is still exact from (x_min, y_min) to (x_max, y_max), provided the changes
+ * since are passed to graphic_update_cells_image().
+ */
+bool graphic_cells_image_exact(unsigned width, unsigned height, unsigned x_min, unsigned x_max,
+                               unsigned y_min, unsigned y_max, bool dark_theme);
+/**
+ * Write the cells that were born or died into the image, the rest is left as is.
+ */
+void graphic_update_cells_image(const std::vector<Coordinates>& born,
+                                const std::vector<Coordinates>& died);
+/**
+ * Paint the image from (x_min, y_min) to (x_max, y_max) without updating it,
+ * where it shows the world.
+ */
+void graphic_paint_cells_image(unsigned x_min, unsigned x_max, unsigned y_min, unsigned y_max);
+/**
+ * Draw the share of live cells of each block of 2^level x 2^level cells, as
+ * an image of the blocks shaded from transparent (none) to the color of the
+ * cells (all). Only the blocks from (x_min, y_min) to (x_max, y_max) are
+ * updated and painted.
+ * @param counts Live cells of block (i, j) at j * width + i.
+ */
+void graphic_draw_density_image(const std::vector<uint16_t>& counts, unsigned width, unsigned height,
+                                unsigned level, unsigned x_min, unsigned x_max,
+                                unsigned y_min, unsigned y_max, bool dark_theme);
 void graphic_ghost_pattern(unsigned x, unsigned y, std::vector<Coordinates> cells, bool ref_color);
 void graphic_draw_select_rec(unsigned x_0, unsigned y_0, unsigned x, unsigned y, bool ref_color);
 void graphic_highlight_selected_cells(std::vector<Coordinates> selected_cells, bool ref_color);
+/**
+ * Draw the heat of the cells from (x_min, y_min) to (x_max, y_max), row y of
+ * the world at heat[y * width]. The image is kept and only drawn again when
+ * version, the view or the size changed.
+ */
+void graphic_draw_heatmap(const std::vector<uint16_t>& heat, unsigned width, unsigned height,
+                          uint16_t heat_max, unsigned long version, unsigned x_min,
+                          unsigned x_max, unsigned y_min, unsigned y_max);
+void graphic_draw_time_series(const std::vector<Bucket>& buckets, double width, double height,
+                              bool dark_theme);
+/**
+ * Draw the cells added in green and the cells removed in red, only those from
+ * (x_min, y_min) to (x_max, y_max).
+ * @param added, removed Sorted row by row, as bookmark::compare() gives them.
+ */
+void graphic_draw_diff(const std::vector<Coordinates>& added, const std::vector<Coordinates>& removed,
+                       unsigned x_min, unsigned x_max, unsigned y_min, unsigned y_max);
+void graphic_draw_stability_map(const std::vector<TileState>& states, unsigned tiles_x);
 void graphic_change_light_color_scheme(unsigned id);
 void graphic_change_dark_color_scheme(unsigned id);
 
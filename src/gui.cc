@@ -18,6 +18,8 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <fstream>
 #include <string>
@@ -27,6 +29,9 @@
 #include <thread>
 #include "gui.h"
 #include "graphic_gui.h"
+#include "census.h"
+#include "library.h"
+#include "search.h"
 #include "config.h"
 #include "prefs.h"
 
@@ -40,6 +45,7 @@ static unsigned val(0);
 
 static bool dark_theme_on(false);
 static bool show_grid(false);
+static bool show_stability_map(false);
 
 static bool inserting_pattern(false);
 static bool dragging_frame(false);
@@ -51,16 +57,22 @@ static unsigned x_mouse, y_mouse, x_0_sel_mouse, y_0_sel_mouse;
 //===========================================
 
 MainArea::MainArea()
-:   empty(false) {
+:   empty(false),
+    pattern_size({0, 0}),
+    diff({{}, {}, 0}),
+    refresh_scheduled(false) {
     this->signal_enter_notify_event().connect(sigc::mem_fun(*this,
             &MainArea::on_enter_notify_event));
     this->signal_leave_notify_event().connect(sigc::mem_fun(*this,
             &MainArea::on_leave_notify_event));
     this->set_events(Gdk::ENTER_NOTIFY_MASK | Gdk::LEAVE_NOTIFY_MASK | Gdk::SCROLL_MASK);
     set_size_request(window_width, window_height);
+    cells_image_done.connect(sigc::mem_fun(*this, &MainArea::refresh));
+    graphic_on_cells_image_done([this]() { cells_image_done.emit(); });
 }
 
 MainArea::~MainArea() {
+    graphic_on_cells_image_done(nullptr);
     setFrame(default_frame);
 }
 
@@ -81,6 +93,63 @@ void MainArea::refresh() {
                                get_allocation().get_height());
         win->invalidate_rect(r, false);
     }
+    // Every cell is repainted
+    simulation::clear_changes();
+}
+
+void MainArea::refresh_changes() {
+    auto win = get_window();
+    // What is drawn over the cells may change with them
+    if (!win || empty || !simulation::changes_known() || show_stability_map
+        || current_mode == SELECT || inserting_pattern) {
+        refresh();
+        return;
+    }
+    const unsigned tiles_x((simulation::get_width() + dirty_tile_size - 1) / dirty_tile_size);
+    const unsigned tiles_y((simulation::get_height() + dirty_tile_size - 1) / dirty_tile_size);
+    if (dirty_tiles.size() != tiles_x * tiles_y)
+        dirty_tiles.assign(tiles_x * tiles_y, false);
+    for (auto& cell : simulation::get_changes()) {
+        const unsigned tile(cell.y / dirty_tile_size * tiles_x + cell.x / dirty_tile_size);
+        if (!dirty_tiles[tile]) {
+            dirty_tiles[tile] = true;
+            dirty_list.push_back(tile);
+        }
+    }
+    simulation::BoundingBox all({tiles_x, 0, tiles_y, 0});
+    for (auto tile : dirty_list) {
+        dirty_tiles[tile] = false;
+        const unsigned i(tile % tiles_x), j(tile / tiles_x);
+        if (dirty_list.size() <= dirty_tiles_max) {
+            win->invalidate_rect(device_rect({i * dirty_tile_size, (i + 1) * dirty_tile_size - 1,
+                                              j * dirty_tile_size, (j + 1) * dirty_tile_size - 1}),
+                                 false);
+        }
+        all = {std::min(all.x_min, i), std::max(all.x_max, i),
+               std::min(all.y_min, j), std::max(all.y_max, j)};
+    }
+    if (dirty_list.size() > dirty_tiles_max) {
+        win->invalidate_rect(device_rect({all.x_min * dirty_tile_size, (all.x_max + 1) * dirty_tile_size - 1,
+                                          all.y_min * dirty_tile_size, (all.y_max + 1) * dirty_tile_size - 1}),
+                             false);
+    }
+    dirty_list.clear();
+    simulation::clear_changes();
+}
+
+void MainArea::schedule_refresh() {
+    // The frame clock only ticks while the area is shown
+    if (!refresh_scheduled) {
+        refresh_scheduled = true;
+        add_tick_callback(sigc::mem_fun(*this, &MainArea::on_tick));
+    }
+}
+
+bool MainArea::on_tick(const Glib::RefPtr<Gdk::FrameClock>& frame_clock) {
+    refresh_scheduled = false;
+    refresh_changes();
+    // Called once, schedule_refresh() adds it again
+    return false;
 }
 
 void MainArea::setFrame(Frame f) {
@@ -144,6 +213,30 @@ void MainArea::draw_frame(const Cairo::RefPtr<Cairo::Context>& cr) {
     cr->stroke();
 }
 
+simulation::BoundingBox MainArea::visible_cells(const Cairo::RefPtr<Cairo::Context>& cr) const {
+    double clip_x_min, clip_y_min, clip_x_max, clip_y_max;
+    cr->get_clip_extents(clip_x_min, clip_y_min, clip_x_max, clip_y_max);
+    // Rounded outwards, the frame may extend beyond the world
+    const double x_min(std::floor(std::max(frame.xMin, clip_x_min)) - view_margin);
+    const double y_min(std::floor(std::max(frame.yMin, clip_y_min)) - view_margin);
+    const double x_max(std::min((double)frame.xMax, clip_x_max) + view_margin);
+    const double y_max(std::min((double)frame.yMax, clip_y_max) + view_margin);
+    return {x_min > 0 ? (unsigned)x_min : 0, x_max > 0 ? (unsigned)x_max : 0,
+            y_min > 0 ? (unsigned)y_min : 0, y_max > 0 ? (unsigned)y_max : 0};
+}
+
+Gdk::Rectangle MainArea::device_rect(const simulation::BoundingBox& cells) const {
+    // The inverse of orthographic_projection(), rounded outwards by a pixel
+    // for the antialiased edges
+    const double scale_x(frame.width / (frame.xMax - frame.xMin));
+    const double scale_y(frame.height / (frame.yMax - frame.yMin));
+    const int left(std::floor((cells.x_min - cell_size/2. - frame.xMin) * scale_x) - 1);
+    const int right(std::ceil((cells.x_max + cell_size/2. - frame.xMin) * scale_x) + 1);
+    const int top(std::floor((frame.yMax - cells.y_max - cell_size/2.) * scale_y) - 1);
+    const int bottom(std::ceil((frame.yMax - cells.y_min + cell_size/2.) * scale_y) + 1);
+    return Gdk::Rectangle(left, top, right - left, bottom - top);
+}
+
 bool MainArea::on_draw(const Cairo::RefPtr<Cairo::Context>& cr) {
     if (!empty) {
         graphic_set_context(cr);
@@ -153,8 +246,14 @@ bool MainArea::on_draw(const Cairo::RefPtr<Cairo::Context>& cr) {
         adjustFrame();
         orthographic_projection(cr, frame);
 
-        graphic_draw_world(simulation::get_width(), simulation::get_height(), dark_theme_on, show_grid, default_frame.xMax-default_frame.xMin);
-        simulation::draw_cells(dark_theme_on);
+        graphic_draw_world(simulation::get_width(), simulation::get_height(), dark_theme_on, show_grid, default_frame.xMax-default_frame.xMin,
+                           frame.width, frame.height);
+        const simulation::BoundingBox view(visible_cells(cr));
+        simulation::draw_cells(dark_theme_on, view, frame.width/(frame.xMax - frame.xMin));
+        simulation::draw_heatmap(view);
+        if (show_stability_map)
+            simulation::draw_stability_map();
+        graphic_draw_diff(diff.added, diff.removed, view.x_min, view.x_max, view.y_min, view.y_max);
 
         if (inserting_pattern) {
             graphic_ghost_pattern(x_mouse, y_mouse, pattern, dark_theme_on);
@@ -170,6 +269,22 @@ bool MainArea::on_draw(const Cairo::RefPtr<Cairo::Context>& cr) {
     return true;
 }
 
+PlotArea::PlotArea() {
+    set_size_request(plot_width, plot_height);
+}
+
+PlotArea::~PlotArea() {}
+
+bool PlotArea::on_draw(const Cairo::RefPtr<Cairo::Context>& cr) {
+    const int width(get_allocation().get_width());
+    const int height(get_allocation().get_height());
+    graphic_set_context(cr);
+    // One bucket per pixel at most
+    graphic_draw_time_series(simulation::get_time_series().overview(width), width, height,
+                             dark_theme_on);
+    return true;
+}
+
 void MainArea::flip_pattern_left_right() {
     unsigned width(pattern_width());
         for (auto& e : pattern) {
@@ -192,6 +307,22 @@ void MainArea::rotate_pattern() {
         e.x = height - e.y;
         e.y = tmp;
     }
+    pattern_size = {pattern_size.y, pattern_size.x};
+}
+
+void MainArea::set_pattern(std::vector<Coordinates> data) {
+    pattern = data;
+    if (pattern.empty()) {
+        pattern_size = {0, 0};
+        return;
+    }
+    Coordinates low(pattern.front());
+    Coordinates high(pattern.front());
+    for (auto& e : pattern) {
+        low = {std::min(low.x, e.x), std::min(low.y, e.y)};
+        high = {std::max(high.x, e.x), std::max(high.y, e.y)};
+    }
+    pattern_size = {high.x - low.x, high.y - low.y};
 }
 
 std::vector<Coordinates> MainArea::rebase_coords(std::vector<Coordinates> abs_coords) {
@@ -212,34 +343,6 @@ std::vector<Coordinates> MainArea::rebase_coords(std::vector<Coordinates> abs_co
     return abs_coords;
 }
 
-unsigned MainArea::pattern_width() {
-    unsigned max(0);
-    unsigned min(simulation::get_width());
-
-    for (unsigned i(0); i < pattern.size(); ++i) {
-        if (pattern[i].x > max)
-            max = pattern[i].x;
-        if (pattern[i].x < min)
-            min = pattern[i].x;
-    }
-
-    return max-min;
-}
-
-unsigned MainArea::pattern_height() {
-    unsigned max(0);
-    unsigned min(simulation::get_height());
-
-    for (unsigned i(0); i < pattern.size(); ++i) {
-        if (pattern[i].y > max)
-            max = pattern[i].y;
-        if (pattern[i].y < min)
-            min = pattern[i].y;
-    }
-
-    return max-min;
-}
-
 bool MainArea::on_enter_notify_event(GdkEventCrossing * crossing_event) {
     in_MyArea_window = (crossing_event->type == GDK_ENTER_NOTIFY);
     return in_MyArea_window;
@@ -332,6 +435,11 @@ SimulationWindow::SimulationWindow(Glib::RefPtr<Gtk::Application> app,
 
     zoom_frame();
 
+    m_PlotWindow.set_title("Statistics - " + PROGRAM_NAME);
+    m_PlotWindow.set_transient_for(*this);
+    m_PlotWindow.add(m_Plot);
+    m_Plot.show();
+
     show_all_children();
     m_Area.refresh();
     preserve_aspect_ratio();
@@ -449,9 +557,24 @@ void SimulationWindow::updt_statusbar() {
         mouse_coord += " (" + std::to_string(n_selected) + " selected)";
     const Glib::ustring zoom_level("\t\t" + std::to_string(zoom) + "%\t\t");
     const Glib::ustring dim(std::to_string(simulation::get_width()) + " x " + std::to_string(simulation::get_height()));
-    Glib::ustring status(generation + population + mouse_coord + zoom_level + dim);
-    if (experiment)
-        status = "Stability detection enabled\t\t" + status;
+    const simulation::BoundingBox box(simulation::get_bounding_box());
+    Glib::ustring extent;
+    if (box.x_min <= box.x_max)
+        extent = "Bounding box: " + std::to_string(box.x_max - box.x_min + 1) + " x "
+                 + std::to_string(box.y_max - box.y_min + 1) + "\t\t";
+    Glib::ustring status(generation + population + extent + mouse_coord + zoom_level + dim);
+    const Glib::ustring period(std::to_string(simulation::get_period()));
+    if (!simulation::get_speed().empty())
+        status = (simulation::is_puffer() ? "Puffer " : "Spaceship ") + simulation::get_speed()
+                 + ", period " + period + "\t\t" + status;
+    else if (experiment) {
+        if (simulation::get_period() != 0)
+            status = "Stable, period " + period + "\t\t" + status;
+        else if (simulation::is_settled())
+            status = "Settled, every tile is still or oscillating\t\t" + status;
+        else
+            status = "Stability detection enabled\t\t" + status;
+    }
     m_StatusBar.pop();
     m_StatusBar.push(status);
 }
@@ -757,10 +880,6 @@ bool SimulationWindow::on_timeout() {
             css_provider->load_from_data("button {background-image: image(green);}");
             m_Button_Start.get_style_context()->add_provider(css_provider,
                                                              GTK_STYLE_PROVIDER_PRIORITY_USER);
-            if (val < 4)
-                val = 0;
-            else
-                val -= 4;
             // Stop the timer
             delete_timer();
         }
@@ -776,7 +895,9 @@ bool SimulationWindow::on_timeout() {
     if (current_mode == SELECT)
         update_selection();
     file_modified();
-    m_Area.refresh();
+    m_Area.schedule_refresh();
+    if (m_PlotWindow.get_visible())
+        m_Plot.queue_draw();
     return true;
 }
 
@@ -787,6 +908,10 @@ bool SimulationWindow::on_key_press_event(GdkEventKey * key_event) {
             SimulationWindow::on_button_start_clicked();
             return false;
         }
+        if (key_event->keyval == GDK_KEY_Escape && !inserting_pattern) {
+            m_Area.clear_diff();
+            m_Area.refresh();
+        }
         if (key_event->keyval == GDK_KEY_Escape && inserting_pattern) {
             inserting_pattern = false;
             rotateMi->set_sensitive(false);
@@ -1052,6 +1177,8 @@ bool SimulationWindow::on_delete_event(GdkEventAny * any_event) {
 void SimulationWindow::on_action_new() {
     val = 0;
     simulation::init();
+    bookmark::clear();
+    m_Area.clear_diff();
     this->set_title(PROGRAM_NAME);
 
     updt_statusbar();
@@ -1084,6 +1211,9 @@ void SimulationWindow::on_action_open() {
         // Read data and check for any error
         int reading_result(simulation::read_file(filename));
         if (reading_result == 0) {
+            // The bookmarks were snapshots of the previous pattern
+            bookmark::clear();
+            m_Area.clear_diff();
 
             on_action_reset_zoom();
             updt_statusbar();
@@ -1347,6 +1477,36 @@ void SimulationWindow::on_action_reset_zoom() {
     updt_statusbar();
 }
 
+void SimulationWindow::on_action_zoom_to_fit() {
+    const simulation::BoundingBox box(simulation::get_bounding_box());
+    if (box.x_min > box.x_max)
+        return;
+
+    // Smallest zoom step showing the whole bounding box plus a 10% margin
+    const double fraction(1.1 * std::max((box.x_max - box.x_min + 1.) / simulation::get_width(),
+                                         (box.y_max - box.y_min + 1.) / simulation::get_height()));
+    const unsigned zoom_diff(std::min(100., 10 * std::ceil(fraction * 10)));
+    zoom = (fraction <= 0.05) ? zoom_max : zoom_max - zoom_diff;
+
+    // Center the frame on the bounding box, zoom_frame() keeps it inside the world
+    set_default_frame();
+    const double dx((box.x_min + box.x_max) / 2. - (default_frame.xMin + default_frame.xMax) / 2.);
+    const double dy((box.y_min + box.y_max) / 2. - (default_frame.yMin + default_frame.yMax) / 2.);
+    default_frame.xMin += dx;
+    default_frame.xMax += dx;
+    default_frame.yMin += dy;
+    default_frame.yMax += dy;
+    zoom_frame();
+
+    zoominMi->set_sensitive(zoom < zoom_max);
+    toolbutton_zoomin->set_sensitive(zoom < zoom_max);
+    zoomoutMi->set_sensitive(zoom > 100);
+    toolbutton_zoomout->set_sensitive(zoom > 100);
+    resetzoomMi->set_sensitive();
+    toolbutton_resetzoom->set_sensitive();
+    updt_statusbar();
+}
+
 void SimulationWindow::on_checkbutton_grid_checked() {
     bool active(false);
     m_refActionGrid->get_state(active);
@@ -1360,6 +1520,41 @@ void SimulationWindow::on_checkbutton_fade_checked() {
     simulation::toggle_fade_effect();
 }
 
+void SimulationWindow::on_checkbutton_pixel_renderer_checked() {
+    simulation::toggle_pixel_renderer();
+    m_Area.refresh();
+}
+
+void SimulationWindow::on_checkbutton_heatmap_checked() {
+    simulation::toggle_heatmap();
+    m_Area.refresh();
+}
+
+void SimulationWindow::on_checkbutton_stability_map_checked() {
+    show_stability_map = !show_stability_map;
+    m_Area.refresh();
+}
+
+void SimulationWindow::on_action_export_heatmap() {
+    auto dialog = Gtk::FileChooserNative::create("Export the heatmap", Gtk::FILE_CHOOSER_ACTION_SAVE,
+                                                 "_Save", "_Cancel");
+    auto filter = Gtk::FileFilter::create();
+    filter->set_name("Grayscale image (PGM)");
+    filter->add_pattern("*.pgm");
+    dialog->add_filter(filter);
+    dialog->set_current_name("heatmap.pgm");
+
+    if (dialog->run() != Gtk::RESPONSE_ACCEPT)
+        return;
+    if (!simulation::save_heatmap(dialog->get_filename())) {
+        Gtk::MessageDialog error_dial("The heatmap could not be exported", false,
+                                      Gtk::MESSAGE_ERROR, Gtk::BUTTONS_CLOSE, true);
+        error_dial.set_secondary_text("Enable View > Activity Heatmap and run the simulation first.");
+        error_dial.set_transient_for(*this);
+        error_dial.run();
+    }
+}
+
 void SimulationWindow::on_checkbutton_dark_checked() {
     bool active(false);
     m_refActionDark->get_state(active);
@@ -1416,6 +1611,347 @@ void SimulationWindow::on_action_experiment() {
     updt_statusbar();
 }
 
+void SimulationWindow::on_action_census() {
+    const std::vector<census::Object> objects(census::take(simulation::get_state()));
+
+    // Shows the table in a scrollable pop-up message dialog
+    Gtk::MessageDialog census_dial("Objects found at generation " + std::to_string(val), false,
+                                   Gtk::MESSAGE_INFO, Gtk::BUTTONS_NONE, true);
+    Gtk::ScrolledWindow scrolled_win;
+    Gtk::Label label_table;
+    label_table.set_markup("<tt>" + Glib::Markup::escape_text(census::format_table(objects)) + "</tt>");
+    label_table.set_selectable();
+    scrolled_win.add(label_table);
+    scrolled_win.set_size_request(600, 400);
+    Gtk::Box* marea = census_dial.get_message_area();
+    marea->pack_start(scrolled_win);
+
+    census_dial.add_button("_Export CSV...", Gtk::RESPONSE_APPLY);
+    census_dial.add_button("_Close", Gtk::RESPONSE_CLOSE);
+    census_dial.set_title("Census");
+    census_dial.set_transient_for(*this);
+    census_dial.show_all_children();
+    if (census_dial.run() != Gtk::RESPONSE_APPLY)
+        return;
+    census_dial.hide();
+
+    auto dialog = Gtk::FileChooserNative::create("Export the census", Gtk::FILE_CHOOSER_ACTION_SAVE,
+                                                 "_Save", "_Cancel");
+    auto filter = Gtk::FileFilter::create();
+    filter->set_name("CSV");
+    filter->add_pattern("*.csv");
+    dialog->add_filter(filter);
+    dialog->set_current_name("census.csv");
+
+    if (dialog->run() == Gtk::RESPONSE_ACCEPT)
+        census::save_csv(dialog->get_filename(), objects);
+}
+
+void SimulationWindow::on_action_add_bookmark() {
+    Gtk::Dialog dialog("Add Bookmark", *this, true);
+    Gtk::Entry entry;
+    entry.set_text("Generation " + std::to_string(val));
+    entry.set_activates_default();
+    dialog.get_content_area()->pack_start(entry);
+    dialog.add_button("_Cancel", Gtk::RESPONSE_CANCEL);
+    dialog.add_button("_Add", Gtk::RESPONSE_OK);
+    dialog.set_default_response(Gtk::RESPONSE_OK);
+    dialog.show_all_children();
+    if (dialog.run() == Gtk::RESPONSE_OK)
+        bookmark::add(entry.get_text(), val);
+}
+
+void SimulationWindow::on_action_compare_bookmarks() {
+    const std::vector<bookmark::Bookmark>& bookmarks(bookmark::get_bookmarks());
+    if (bookmarks.empty()) {
+        warning_dialog_open("There is no bookmark to compare",
+                            "Use Tools > Add Bookmark to keep the current state first.");
+        return;
+    }
+
+    // The last entry of both lists is the current state
+    Gtk::Dialog dialog("Compare Bookmarks", *this, true);
+    Gtk::Grid grid;
+    Gtk::Label label_before("Before:"), label_after("After:");
+    Gtk::ComboBoxText combo_before, combo_after;
+    for (auto& entry : bookmarks) {
+        combo_before.append(entry.name);
+        combo_after.append(entry.name);
+    }
+    combo_before.append("Current state");
+    combo_after.append("Current state");
+    combo_before.set_active(bookmarks.size() - 1);
+    combo_after.set_active(bookmarks.size());
+    grid.set_row_spacing(5);
+    grid.set_column_spacing(10);
+    grid.attach(label_before, 0, 0);
+    grid.attach(combo_before, 1, 0);
+    grid.attach(label_after, 0, 1);
+    grid.attach(combo_after, 1, 1);
+    dialog.get_content_area()->pack_start(grid);
+    dialog.add_button("_Cancel", Gtk::RESPONSE_CANCEL);
+    dialog.add_button("_Compare", Gtk::RESPONSE_OK);
+    dialog.show_all_children();
+    if (dialog.run() != Gtk::RESPONSE_OK)
+        return;
+    dialog.hide();
+
+    const bookmark::Bookmark current(bookmark::take("Current state", val));
+    const unsigned before(combo_before.get_active_row_number());
+    const unsigned after(combo_after.get_active_row_number());
+    const bookmark::Diff diff(bookmark::compare(before < bookmarks.size() ? bookmarks[before] : current,
+                                                after < bookmarks.size() ? bookmarks[after] : current));
+    m_Area.set_diff(diff);
+    m_Area.refresh();
+
+    Gtk::MessageDialog result_dial(std::to_string(diff.added.size()) + " cells added (green), "
+                                   + std::to_string(diff.removed.size()) + " cells removed (red), "
+                                   + std::to_string(diff.unchanged) + " cells unchanged",
+                                   false, Gtk::MESSAGE_INFO, Gtk::BUTTONS_CLOSE, true);
+    result_dial.set_secondary_text("Press Escape to hide the highlighted cells.");
+    result_dial.set_title("Compare Bookmarks");
+    result_dial.set_transient_for(*this);
+    result_dial.run();
+}
+
+void SimulationWindow::on_action_statistics() {
+    m_PlotWindow.present();
+}
+
+void SimulationWindow::on_action_identify() {
+    // The index is only loaded the first time the library is used, on its own
+    // threads while a dialog shows the progress of its building
+    if (!library::index_loaded()) {
+        library::Progress progress;
+        std::atomic<bool> finished(false);
+        std::thread loader([&]() {
+            library::load_index(working_dir() + PATTERNS_DIR, working_dir() + LIBRARY_INDEX_FILE,
+                                progress);
+            finished = true;
+        });
+        Gtk::Dialog progress_dial("Identify Selection", *this, true);
+        Gtk::ProgressBar progress_bar;
+        progress_bar.set_text("Indexing the pattern library...");
+        progress_bar.set_show_text();
+        progress_bar.set_size_request(400, -1);
+        progress_dial.get_content_area()->pack_start(progress_bar);
+        progress_dial.add_button("_Cancel", Gtk::RESPONSE_CANCEL);
+        progress_dial.show_all_children();
+        sigc::connection poll(Glib::signal_timeout().connect([&]() {
+            if (finished) {
+                progress_dial.response(Gtk::RESPONSE_OK);
+                return false;
+            }
+            if (progress.total != 0)
+                progress_bar.set_fraction((double)progress.done / progress.total);
+            return true;
+        }, 200));
+        if (progress_dial.run() != Gtk::RESPONSE_OK)
+            progress.cancel = true;
+        poll.disconnect();
+        loader.join();
+        progress_dial.hide();
+        if (!library::index_loaded())
+            return;
+    }
+
+    std::string text;
+    const std::vector<Coordinates> selection(m_Area.get_selection());
+    if (selection.empty()) {
+        text = "Select a pattern to identify first.";
+    } else {
+        for (auto& match : library::identify(selection)) {
+            text += match.name + " (" + match.filename + ")";
+            if (match.phase != 0)
+                text += ", after " + std::to_string(match.phase) + " generations";
+            text += "\n";
+        }
+        if (text.empty())
+            text = "This pattern is not in the library.";
+    }
+
+    Gtk::MessageDialog identify_dial(text, false, Gtk::MESSAGE_INFO, Gtk::BUTTONS_CLOSE, true);
+    identify_dial.set_title("Identify Selection");
+    identify_dial.set_transient_for(*this);
+    identify_dial.run();
+}
+
+void SimulationWindow::on_action_collision_search() {
+    const std::vector<Coordinates> target(m_Area.get_clipboard());
+    if (target.empty()) {
+        warning_dialog_open("The clipboard is empty",
+                            "Copy the target of the collisions (Ctrl + C) first.");
+        return;
+    }
+
+    Gtk::Dialog dialog("Collision Search", *this, true);
+    Gtk::Grid grid;
+    Gtk::Label label_projectile("Projectile:");
+    Gtk::ComboBoxText combo_projectile;
+    for (auto name : { "Glider", "LWSS", "MWSS", "HWSS" }) {
+        combo_projectile.append(name);
+    }
+    combo_projectile.set_active(0);
+    grid.set_column_spacing(10);
+    grid.attach(label_projectile, 0, 0);
+    grid.attach(combo_projectile, 1, 0);
+    dialog.get_content_area()->pack_start(grid);
+    dialog.add_button("_Cancel", Gtk::RESPONSE_CANCEL);
+    dialog.add_button("_Search", Gtk::RESPONSE_OK);
+    dialog.show_all_children();
+    if (dialog.run() != Gtk::RESPONSE_OK)
+        return;
+    dialog.hide();
+
+    // The search runs on its own threads while the dialog shows its progress
+    const search::Projectile projectile((search::Projectile)combo_projectile.get_active_row_number());
+    search::Progress progress;
+    search::CollisionSearch collisions;
+    std::atomic<bool> finished(false);
+    std::thread searcher([&]() {
+        collisions = search::collide(target, projectile, thread_count(), progress);
+        finished = true;
+    });
+    Gtk::Dialog progress_dial("Collision Search", *this, true);
+    Gtk::ProgressBar progress_bar;
+    progress_bar.set_text("Running the collisions...");
+    progress_bar.set_show_text();
+    progress_bar.set_size_request(400, -1);
+    progress_dial.get_content_area()->pack_start(progress_bar);
+    progress_dial.add_button("_Cancel", Gtk::RESPONSE_CANCEL);
+    progress_dial.show_all_children();
+    sigc::connection poll(Glib::signal_timeout().connect([&]() {
+        if (finished) {
+            progress_dial.response(Gtk::RESPONSE_OK);
+            return false;
+        }
+        if (progress.total != 0)
+            progress_bar.set_fraction((double)progress.done / progress.total);
+        return true;
+    }, 200));
+    if (progress_dial.run() != Gtk::RESPONSE_OK)
+        progress.cancel = true;
+    poll.disconnect();
+    searcher.join();
+    progress_dial.hide();
+    if (progress.cancel)
+        return;
+    const std::string text(search::format_collisions(collisions));
+
+    // Shows the results in a scrollable pop-up message dialog, the RLE can be copied
+    Gtk::MessageDialog result_dial("Collisions with the clipboard", false, Gtk::MESSAGE_INFO,
+                                   Gtk::BUTTONS_NONE, true);
+    Gtk::ScrolledWindow scrolled_win;
+    Gtk::Label label_results;
+    label_results.set_markup("<tt>" + Glib::Markup::escape_text(text) + "</tt>");
+    label_results.set_selectable();
+    scrolled_win.add(label_results);
+    scrolled_win.set_size_request(600, 400);
+    Gtk::Box* marea = result_dial.get_message_area();
+    marea->pack_start(scrolled_win);
+
+    result_dial.add_button("_Save...", Gtk::RESPONSE_APPLY);
+    result_dial.add_button("_Close", Gtk::RESPONSE_CLOSE);
+    result_dial.set_title("Collision Search");
+    result_dial.set_transient_for(*this);
+    result_dial.show_all_children();
+    if (result_dial.run() != Gtk::RESPONSE_APPLY)
+        return;
+    result_dial.hide();
+
+    auto file_dialog = Gtk::FileChooserNative::create("Save the collisions", Gtk::FILE_CHOOSER_ACTION_SAVE,
+                                                      "_Save", "_Cancel");
+    file_dialog->set_current_name("collisions.txt");
+    if (file_dialog->run() == Gtk::RESPONSE_ACCEPT) {
+        std::ofstream file(file_dialog->get_filename());
+        file << text;
+    }
+}
+
+void SimulationWindow::on_action_find_parent() {
+    const std::vector<Coordinates> target(m_Area.get_selection());
+    if (target.empty()) {
+        warning_dialog_open("The selection is empty",
+                            "Select the pattern to find a parent of first.");
+        return;
+    }
+    unsigned x_min(target.front().x), x_max(x_min), y_min(target.front().y), y_max(y_min);
+    for (auto& cell : target) {
+        x_min = std::min(x_min, cell.x);
+        x_max = std::max(x_max, cell.x);
+        y_min = std::min(y_min, cell.y);
+        y_max = std::max(y_max, cell.y);
+    }
+    const unsigned side(std::min(x_max - x_min, y_max - y_min) + 1);
+    if (side + 2 > predecessor_width_max) {
+        warning_dialog_open("The selection is too large",
+                            "Both sides of the selection are longer than "
+                            + std::to_string(predecessor_width_max - 2) + " cells.");
+        return;
+    }
+
+    Gtk::Dialog dialog("Find Parent", *this, true);
+    Gtk::Grid grid;
+    Gtk::Label label_margin("Margin around the selection:");
+    Gtk::SpinButton spin_margin;
+    spin_margin.set_range(1, std::min(predecessor_margin_max, (predecessor_width_max - side) / 2));
+    spin_margin.set_increments(1, 1);
+    spin_margin.set_value(1);
+    grid.set_column_spacing(10);
+    grid.attach(label_margin, 0, 0);
+    grid.attach(spin_margin, 1, 0);
+    dialog.get_content_area()->pack_start(grid);
+    dialog.add_button("_Cancel", Gtk::RESPONSE_CANCEL);
+    dialog.add_button("_Search", Gtk::RESPONSE_OK);
+    dialog.show_all_children();
+    if (dialog.run() != Gtk::RESPONSE_OK)
+        return;
+    dialog.hide();
+
+    // The search runs on its own threads while the dialog shows its progress,
+    // the widgets are only read here
+    const unsigned margin(spin_margin.get_value_as_int());
+    search::Progress progress;
+    search::Predecessor predecessor;
+    std::atomic<bool> finished(false);
+    std::thread searcher([&, margin]() {
+        predecessor = search::predecessor(target, margin, thread_count(), progress);
+        finished = true;
+    });
+    Gtk::Dialog progress_dial("Find Parent", *this, true);
+    Gtk::ProgressBar progress_bar;
+    progress_bar.set_text("Searching for a parent...");
+    progress_bar.set_show_text();
+    progress_bar.set_size_request(400, -1);
+    progress_dial.get_content_area()->pack_start(progress_bar);
+    progress_dial.add_button("_Cancel", Gtk::RESPONSE_CANCEL);
+    progress_dial.show_all_children();
+    sigc::connection poll(Glib::signal_timeout().connect([&]() {
+        if (finished) {
+            progress_dial.response(Gtk::RESPONSE_OK);
+            return false;
+        }
+        if (progress.total != 0)
+            progress_bar.set_fraction((double)progress.done / progress.total);
+        return true;
+    }, 200));
+    if (progress_dial.run() != Gtk::RESPONSE_OK)
+        progress.cancel = true;
+    poll.disconnect();
+    searcher.join();
+    progress_dial.hide();
+
+    if (predecessor.result == search::PARENT_FOUND)
+        m_Area.set_clipboard(predecessor.cells);
+    Gtk::MessageDialog result_dial(search::format_predecessor(predecessor), false, Gtk::MESSAGE_INFO,
+                                   Gtk::BUTTONS_CLOSE, true);
+    if (predecessor.result == search::PARENT_FOUND)
+        result_dial.set_secondary_text("The parent is in the clipboard, paste it with Ctrl + V.");
+    result_dial.set_title("Find Parent");
+    result_dial.set_transient_for(*this);
+    result_dial.run();
+}
+
 void SimulationWindow::on_button_increase_size_clicked() {
     stabilize_history();
     cmd_history.push_back(new EnlargeWorldCommand(decrsizeMi, incrsizeMi, randomMi));
@@ -1531,6 +2067,7 @@ void SimulationWindow::on_button_reset_clicked() {
     this->set_title(this->get_title().replace(0, 1, ""));
     updt_statusbar();
     m_Area.refresh();
+    m_Plot.queue_draw();
 }
 
 void SimulationWindow::on_button_slower_clicked() {
@@ -1658,9 +2195,24 @@ void SimulationWindow::create_action_groups(Glib::RefPtr<Gtk::Application> app)
     m_refViewActionGroup->add_action("resetzoom", sigc::mem_fun(*this,
             &SimulationWindow::on_action_reset_zoom));
 
+    m_refViewActionGroup->add_action("zoomtofit", sigc::mem_fun(*this,
+            &SimulationWindow::on_action_zoom_to_fit));
+
     m_refViewActionGroup->add_action("fade", sigc::mem_fun(*this,
             &SimulationWindow::on_checkbutton_fade_checked));
 
+    m_refViewActionGroup->add_action("pixelrenderer", sigc::mem_fun(*this,
+            &SimulationWindow::on_checkbutton_pixel_renderer_checked));
+
+    m_refViewActionGroup->add_action("heatmap", sigc::mem_fun(*this,
+            &SimulationWindow::on_checkbutton_heatmap_checked));
+
+    m_refViewActionGroup->add_action("exportheatmap", sigc::mem_fun(*this,
+            &SimulationWindow::on_action_export_heatmap));
+
+    m_refViewActionGroup->add_action("stabilitymap", sigc::mem_fun(*this,
+            &SimulationWindow::on_checkbutton_stability_map_checked));
+
     m_refViewActionGroup->add_action("scheme", sigc::mem_fun(*this,
             &SimulationWindow::on_button_colorscheme_clicked));
 
@@ -1668,6 +2220,26 @@ void SimulationWindow::create_action_groups(Glib::RefPtr<Gtk::Application> app)
     m_refToolsActionGroup->add_action("experiment", sigc::mem_fun(*this,
             &SimulationWindow::on_action_experiment));
 
+    m_refToolsActionGroup->add_action("census", sigc::mem_fun(*this,
+            &SimulationWindow::on_action_census));
+
+    m_refToolsActionGroup->add_action("identify", sigc::mem_fun(*this,
+            &SimulationWindow::on_action_identify));
+
+    m_refToolsActionGroup->add_action("collisionsearch", sigc::mem_fun(*this,
+            &SimulationWindow::on_action_collision_search));
+    m_refToolsActionGroup->add_action("findparent", sigc::mem_fun(*this,
+            &SimulationWindow::on_action_find_parent));
+
+    m_refToolsActionGroup->add_action("statistics", sigc::mem_fun(*this,
+            &SimulationWindow::on_action_statistics));
+
+    m_refToolsActionGroup->add_action("addbookmark", sigc::mem_fun(*this,
+            &SimulationWindow::on_action_add_bookmark));
+
+    m_refToolsActionGroup->add_action("comparebookmarks", sigc::mem_fun(*this,
+            &SimulationWindow::on_action_compare_bookmarks));
+
     m_refToolsActionGroup->add_action("increasesize", sigc::mem_fun(*this,
             &SimulationWindow::on_button_increase_size_clicked));
 
@@ -1719,6 +2291,7 @@ void SimulationWindow::create_action_groups(Glib::RefPtr<Gtk::Application> app)
     app->set_accel_for_action("view.zoomin", "<Primary>plus");
     app->set_accel_for_action("view.zoomout", "<Primary>minus");
     app->set_accel_for_action("view.resetzoom", "0");
+    app->set_accel_for_action("view.zoomtofit", "f");
     insert_action_group("tools", m_refToolsActionGroup);
     app->set_accel_for_action("tools.increasesize", "<Primary>Page_Up");
     app->set_accel_for_action("tools.decreasesize", "<Primary>Page_Down");
@@ -27,6 +27,7 @@
 #include <gtkmm.h>
 #include "command.h"
 #include "simulation.h"
+#include "bookmark.h"
 
 enum CursorMode { DRAW, SELECT, DRAG };
 
@@ -47,6 +48,8 @@ constexpr unsigned refresh_min(5);
 constexpr unsigned refresh_max(500);
 constexpr unsigned zoom_min(100);
 constexpr unsigned zoom_max(200);
+constexpr unsigned plot_width(600);
+constexpr unsigned plot_height(300);
 
 //===========================================
 
@@ -60,14 +63,23 @@ public:
     void setFrame(Frame x);
     void adjustFrame();
     void refresh();
+    // Invalidate only the squares of cells that changed since the last drawing,
+    // everything if more than the cells may have changed
+    void refresh_changes();
+    // Refresh the changes at the next frame of the display, once however many
+    // generations were computed until then. Nothing is drawn while the area
+    // is not shown.
+    void schedule_refresh();
     void flip_pattern_left_right();
     void flip_pattern_up_down();
     void rotate_pattern();
     std::vector<Coordinates> rebase_coords(std::vector<Coordinates> abs_coords);
 
-    void set_pattern(std::vector<Coordinates> data) { pattern = data; }
+    void set_pattern(std::vector<Coordinates> data);
     void set_selection(std::vector<Coordinates> sel) { selection = sel; }
     void set_clipboard(std::vector<Coordinates> clip) { clipboard = clip; }
+    void set_diff(const bookmark::Diff& d) { diff = d; }
+    void clear_diff() { diff = {{}, {}, 0}; }
 
     std::vector<Coordinates> get_pattern() const { return pattern; }
     std::vector<Coordinates> get_selection() const { return selection; }
@@ -79,13 +91,40 @@ public:
 protected:
     bool on_draw(const Cairo::RefPtr<Cairo::Context>& cr) override;
     void draw_frame(const Cairo::RefPtr<Cairo::Context>& cr);
+    bool on_tick(const Glib::RefPtr<Gdk::FrameClock>& frame_clock);
 private:
-    unsigned pattern_width();
-    unsigned pattern_height();
+    unsigned pattern_width() const { return pattern_size.x; }
+    unsigned pattern_height() const { return pattern_size.y; }
+    // Part of the world in sight in the current frame and in the clip region of
+    // cr, with view_margin cells around
+    simulation::BoundingBox visible_cells(const Cairo::RefPtr<Cairo::Context>& cr) const;
+    // Pixels of the area covering the cells, in the frame of the last drawing
+    Gdk::Rectangle device_rect(const simulation::BoundingBox& cells) const;
     Frame frame;
     Point p1, p2;
     bool empty;
     std::vector<Coordinates> pattern, selection, clipboard;
+    // Comparison of two bookmarks highlighted over the world
+    bookmark::Diff diff;
+    // Extent of the pattern being inserted, measured once by set_pattern()
+    Coordinates pattern_size;
+    // Whether a refresh waits for the next frame
+    bool refresh_scheduled;
+    // Emitted from the worker thread of the pixel renderer when it finished an
+    // image of the world, received on the main thread
+    Glib::Dispatcher cells_image_done;
+    // Squares of dirty_tile_size cells holding changes, by index and as a list
+    std::vector<bool> dirty_tiles;
+    std::vector<unsigned> dirty_list;
+};
+
+// Live plot of the population, births and deaths over the generations
+class PlotArea : public Gtk::DrawingArea {
+public:
+    PlotArea();
+    virtual ~PlotArea();
+protected:
+    bool on_draw(const Cairo::RefPtr<Cairo::Context>& cr) override;
 };
 
 class ModelColumns : public Gtk::TreeModel::ColumnRecord {
@@ -185,12 +224,24 @@ protected:
     void on_action_zoom_in();
     void on_action_zoom_out();
     void on_action_reset_zoom();
+    void on_action_zoom_to_fit();
     void on_checkbutton_grid_checked();
     void on_checkbutton_fade_checked();
+    void on_checkbutton_heatmap_checked();
+    void on_checkbutton_pixel_renderer_checked();
+    void on_action_export_heatmap();
+    void on_checkbutton_stability_map_checked();
     void on_checkbutton_dark_checked();
     void on_button_colorscheme_clicked();
     // Tools menu
     void on_action_experiment();
+    void on_action_census();
+    void on_action_identify();
+    void on_action_collision_search();
+    void on_action_find_parent();
+    void on_action_statistics();
+    void on_action_add_bookmark();
+    void on_action_compare_bookmarks();
     void on_button_increase_size_clicked();
     void on_button_decrease_size_clicked();
     // Help menu
@@ -288,6 +339,8 @@ protected:
     Glib::RefPtr<Gtk::ListStore> m_refTreeModel, m_pattTreeModel;
 
     MainArea m_Area;
+    Gtk::Window m_PlotWindow;
+    PlotArea m_Plot;
     ModelColumns m_Columns;
     Glib::RefPtr<Gio::SimpleAction> m_refCursorMode;
     Glib::RefPtr<Gio::SimpleActionGroup> m_refToggleActionGroup;
@@ -0,0 +1,336 @@
+/*
+ * library.cc
+ * This file is part of GoL Lab, a simulator of Conway's game of life.
+ *
+ * Copyright (C) 2022-2023 Cyprien Lacassagne
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include "library.h"
+#include "census.h"
+#include "simulation.h"
+
+namespace {
+    struct Entry {
+        uint64_t hash;
+        library::Match match;
+    };
+
+    // Files of the library, used to tell whether the cache is up to date. The
+    // stamp mixes the name, size and modification time of every file, so that
+    // an edit keeping the size of a file is noticed.
+    struct Signature {
+        uint64_t n_files;
+        uint64_t n_bytes;
+        uint64_t stamp;
+    };
+
+    const std::string index_header("# GoL Lab pattern library index");
+
+    std::unordered_multimap<uint64_t, library::Match> index;
+    bool loaded(false);
+    // Directory of the library the index was loaded from
+    std::string library_dir;
+
+    std::vector<std::string> rle_files(std::string patterns_dir);
+    Signature signature(const std::vector<std::string>& files);
+    bool read_index(std::string index_file, Signature expected);
+    // @return false if the building was cancelled, the cache is then left as it was.
+    bool build_index(const std::vector<std::string>& files, std::string index_file,
+                     Signature current, library::Progress& progress);
+    std::vector<Entry> index_pattern(std::string path);
+    std::string pattern_name(std::string path);
+    // The cells in the orientation whose sorted list comes first, moved to (0, 0)
+    std::vector<Coordinates> canonical_cells(const std::vector<Coordinates>& cells);
+    uint64_t mix(uint64_t key);
+} /* unnamed namespace */
+
+library::Progress::Progress()
+:   done(0),
+    total(0),
+    cancel(false) {}
+
+void library::load_index(std::string patterns_dir, std::string index_file, Progress& progress) {
+    const std::vector<std::string> files(rle_files(patterns_dir));
+    const Signature current(signature(files));
+    if (!read_index(index_file, current) && !build_index(files, index_file, current, progress))
+        return;
+    library_dir = patterns_dir;
+    loaded = true;
+}
+
+bool library::index_loaded() {
+    return loaded;
+}
+
+uint64_t library::canonical_hash(const std::vector<Coordinates>& cells) {
+    if (cells.empty())
+        return 0;
+    Coordinates low(cells.front());
+    Coordinates high(cells.front());
+    for (auto& cell : cells) {
+        low = {std::min(low.x, cell.x), std::min(low.y, cell.y)};
+        high = {std::max(high.x, cell.x), std::max(high.y, cell.y)};
+    }
+    const unsigned width(high.x - low.x);
+    const unsigned height(high.y - low.y);
+
+    // The sum of the cell keys does not depend on the order of the cells,
+    // the smallest sum among the 8 orientations does not depend on the orientation
+    uint64_t best(UINT64_MAX);
+    for (unsigned orientation(0); orientation < 8; ++orientation) {
+        const bool transpose(orientation & 4);
+        uint64_t sum(0);
+        for (auto& cell : cells) {
+            unsigned u(cell.x - low.x);
+            unsigned v(cell.y - low.y);
+            if (transpose)
+                std::swap(u, v);
+            if (orientation & 1)
+                u = (transpose ? height : width) - u;
+            if (orientation & 2)
+                v = (transpose ? width : height) - v;
+            sum += mix((uint64_t)v << 32 | u);
+        }
+        best = std::min(best, sum);
+    }
+    return best;
+}
+
+std::vector<library::Match> library::identify(const std::vector<Coordinates>& cells) {
+    std::vector<Match> matches;
+    if (cells.empty())
+        return matches;
+    // The hash only picks the candidates, their cells are compared
+    const std::vector<Coordinates> shape(canonical_cells(cells));
+    auto range(index.equal_range(canonical_hash(cells)));
+    for (auto it(range.first); it != range.second; ++it) {
+        std::vector<Coordinates> candidate(simulation::get_rle_data(library_dir + it->second.filename));
+        for (unsigned phase(0); phase < it->second.phase && !candidate.empty(); ++phase) {
+            candidate = census::next_generation(candidate);
+        }
+        if (candidate.size() != shape.size())
+            continue;
+        candidate = canonical_cells(candidate);
+        if (std::equal(shape.begin(), shape.end(), candidate.begin(),
+                       [](const Coordinates& a, const Coordinates& b) { return a.x == b.x && a.y == b.y; }))
+            matches.push_back(it->second);
+    }
+    std::sort(matches.begin(), matches.end(), [](const Match& a, const Match& b) {
+        return a.phase < b.phase || (a.phase == b.phase && a.filename < b.filename);
+    });
+    return matches;
+}
+
+namespace {
+    std::vector<std::string> rle_files(std::string patterns_dir) {
+        std::vector<std::string> files;
+        std::error_code error;
+        for (auto& entry : std::filesystem::directory_iterator(patterns_dir, error)) {
+            if (entry.path().extension() == ".rle")
+                files.push_back(entry.path().string());
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+
+    Signature signature(const std::vector<std::string>& files) {
+        Signature files_signature({files.size(), 0, 0});
+        std::error_code error;
+        for (auto& file : files) {
+            const auto size(std::filesystem::file_size(file, error));
+            if (!error)
+                files_signature.n_bytes += size;
+            const auto time(std::filesystem::last_write_time(file, error));
+            files_signature.stamp = mix(files_signature.stamp + std::hash<std::string>()(file));
+            files_signature.stamp = mix(files_signature.stamp + (error ? 0 : size));
+            files_signature.stamp = mix(files_signature.stamp
+                                        + (error ? 0 : (uint64_t)time.time_since_epoch().count()));
+        }
+        return files_signature;
+    }
+
+    // @return false if the cache is missing or does not match the library.
+    bool read_index(std::string index_file, Signature expected) {
+        std::ifstream file(index_file);
+        std::string line;
+        if (!getline(file, line) || line != index_header)
+            return false;
+        Signature cached({0, 0, 0});
+        std::string tag;
+        if (!getline(file, line))
+            return false;
+        std::istringstream header(line);
+        header >> tag >> cached.n_files >> cached.n_bytes >> cached.stamp;
+        if (tag != "files" || cached.n_files != expected.n_files
+            || cached.n_bytes != expected.n_bytes || cached.stamp != expected.stamp)
+            return false;
+
+        // A truncated or corrupt cache is rebuilt, the last line gives the
+        // number of entries written before it
+        index.clear();
+        while (getline(file, line)) {
+            if (line.compare(0, 4, "end ") == 0) {
+                if (line.substr(4) == std::to_string(index.size()))
+                    return true;
+                break;
+            }
+            // Hash, phase, file name and pattern name are separated by tabulations
+            std::istringstream fields(line);
+            std::string hash, phase, filename, name;
+            if (!getline(fields, hash, '\t') || !getline(fields, phase, '\t')
+                || !getline(fields, filename, '\t') || !getline(fields, name))
+                break;
+            try {
+                index.insert({std::stoull(hash, nullptr, 16),
+                              {name, filename, (unsigned)std::stoul(phase)}});
+            }
+            catch (const std::logic_error&) {
+                break;
+            }
+        }
+        index.clear();
+        return false;
+    }
+
+    bool build_index(const std::vector<std::string>& files, std::string index_file,
+                     Signature current, library::Progress& progress) {
+        const unsigned n_threads(thread_count());
+        std::vector<std::vector<Entry>> entries(files.size());
+        std::vector<std::thread> workers;
+        progress.total = files.size();
+        for (unsigned t(0); t < n_threads; ++t) {
+            workers.emplace_back([&, t]() {
+                for (unsigned k(t); k < files.size() && !progress.cancel; k += n_threads) {
+                    entries[k] = index_pattern(files[k]);
+                    ++progress.done;
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        if (progress.cancel)
+            return false;
+
+        index.clear();
+        std::ofstream file(index_file);
+        file << index_header << "\n";
+        file << "files " << current.n_files << " " << current.n_bytes << " " << current.stamp << "\n";
+        for (auto& pattern_entries : entries) {
+            for (auto& entry : pattern_entries) {
+                index.insert({entry.hash, entry.match});
+                file << std::hex << entry.hash << "\t" << std::dec << entry.match.phase << "\t"
+                     << entry.match.filename << "\t" << entry.match.name << "\n";
+            }
+        }
+        file << "end " << index.size() << "\n";
+        return true;
+    }
+
+    // @return One entry per distinct hash among the first phases of the pattern.
+    std::vector<Entry> index_pattern(std::string path) {
+        std::vector<Entry> entries;
+        std::vector<Coordinates> cells(simulation::get_rle_data(path));
+        const std::string name(pattern_name(path));
+        const std::string filename(std::filesystem::path(path).filename().string());
+        std::vector<uint64_t> hashes;
+        for (unsigned phase(0); phase < library_phases && !cells.empty(); ++phase) {
+            const uint64_t hash(library::canonical_hash(cells));
+            if (std::find(hashes.begin(), hashes.end(), hash) == hashes.end()) {
+                hashes.push_back(hash);
+                entries.push_back({hash, {name, filename, phase}});
+            }
+
+            Coordinates high({0, 0});
+            for (auto& cell : cells) {
+                high = {std::max(high.x, cell.x), std::max(high.y, cell.y)};
+            }
+            if (high.x >= library_evolve_size_max || high.y >= library_evolve_size_max)
+                break;
+            cells = census::next_generation(cells);
+        }
+        return entries;
+    }
+
+    // @return The name given by the "#N" line of the RLE file, or the file name.
+    std::string pattern_name(std::string path) {
+        std::ifstream file(path);
+        std::string line;
+        while (getline(file, line) && !line.empty() && line[0] == '#') {
+            if (line.compare(0, 2, "#N") == 0) {
+                const size_t start(line.find_first_not_of(" \t", 2));
+                const size_t end(line.find_last_not_of(" \t\r"));
+                if (start != std::string::npos && end >= start)
+                    return line.substr(start, end - start + 1);
+            }
+        }
+        return std::filesystem::path(path).stem().string();
+    }
+
+    std::vector<Coordinates> canonical_cells(const std::vector<Coordinates>& cells) {
+        if (cells.empty())
+            return {};
+        Coordinates low(cells.front());
+        Coordinates high(cells.front());
+        for (auto& cell : cells) {
+            low = {std::min(low.x, cell.x), std::min(low.y, cell.y)};
+            high = {std::max(high.x, cell.x), std::max(high.y, cell.y)};
+        }
+        const unsigned width(high.x - low.x);
+        const unsigned height(high.y - low.y);
+        const auto row_major([](const Coordinates& a, const Coordinates& b) {
+            return a.y < b.y || (a.y == b.y && a.x < b.x);
+        });
+
+        // Same orientations as canonical_hash()
+        std::vector<Coordinates> best, oriented(cells.size());
+        for (unsigned orientation(0); orientation < 8; ++orientation) {
+            const bool transpose(orientation & 4);
+            for (size_t i(0); i < cells.size(); ++i) {
+                unsigned u(cells[i].x - low.x);
+                unsigned v(cells[i].y - low.y);
+                if (transpose)
+                    std::swap(u, v);
+                if (orientation & 1)
+                    u = (transpose ? height : width) - u;
+                if (orientation & 2)
+                    v = (transpose ? width : height) - v;
+                oriented[i] = {u, v};
+            }
+            std::sort(oriented.begin(), oriented.end(), row_major);
+            if (best.empty() || std::lexicographical_compare(oriented.begin(), oriented.end(),
+                                                             best.begin(), best.end(), row_major))
+                best = oriented;
+        }
+        return best;
+    }
+
+    // SplitMix64 finalizer
+    uint64_t mix(uint64_t key) {
+        key += 0x9e3779b97f4a7c15;
+        key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9;
+        key = (key ^ (key >> 27)) * 0x94d049bb133111eb;
+        return key ^ (key >> 31);
+    }
+} /* unnamed namespace */
@@ -0,0 +1,91 @@
+/*
+ * library.h
+ * This module identifies a pattern against the pattern library. Every
+ * library pattern is indexed by a hash that does not depend on its
+ * position nor its orientation, for its first few phases, so that a
+ * selection is identified by a single lookup. The index is built once
+ * and cached on disk.
+ *
+ * This file is part of GoL Lab, a simulator of Conway's game of life.
+ *
+ * Copyright (C) 2022-2023 Cyprien Lacassagne
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBRARY_H
+#define LIBRARY_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "config.h"
+
+// Number of phases of each library pattern put in the index
+constexpr unsigned library_phases(8);
+// Patterns whose bounding box exceeds this size are only indexed as drawn
+constexpr unsigned library_evolve_size_max(1000);
+
+namespace library {
+    struct Match {
+        std::string name;
+        std::string filename;
+        // Generations the library pattern has to be run to get the same shape
+        unsigned phase;
+    };
+
+    // Shared between the loading of the index and the thread that watches it
+    struct Progress {
+        Progress();
+
+        // Files indexed out of total, total is set once the index has to be built
+        std::atomic<unsigned long> done;
+        std::atomic<unsigned long> total;
+        // Set to stop building the index as soon as possible
+        std::atomic<bool> cancel;
+    };
+
+    /**
+     * Load the index of the library from its cache file. The index is built
+     * from the RLE files and saved first if the cache file is missing or if
+     * the library has changed since it was written. The index stays unloaded
+     * if the building is cancelled.
+     * @param patterns_dir Directory of the library.
+     * @param index_file Cache file of the index.
+     */
+    void load_index(std::string patterns_dir, std::string index_file, Progress& progress);
+
+    /**
+     * @return true if the index has been loaded.
+     */
+    bool index_loaded();
+
+    /**
+     * @return A hash of the pattern that is the same for all its
+     * translations, rotations and reflections.
+     */
+    uint64_t canonical_hash(const std::vector<Coordinates>& cells);
+
+    /**
+     * Look a pattern up in the index.
+     * @param cells The live cells of the pattern.
+     * @return The library patterns with the same shape in one of their indexed
+     * phases, the patterns matching as drawn first. The candidates sharing the
+     * hash of the pattern are checked cell by cell.
+     */
+    std::vector<Match> identify(const std::vector<Coordinates>& cells);
+} /* namespace library */
+
+#endif
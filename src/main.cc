@@ -21,15 +21,48 @@
 #include "simulation.h"
 #include "gui.h"
 #include "config.h"
+#include "search.h"
+#include "graphic.h"
 #include <iostream>
 #include <gtkmm/application.h>
 #include <cstdlib>
 #include <string>
 #include <cstdio>
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <thread>
+#include <chrono>
+#include <atomic>
+
+namespace {
+	typedef std::map<std::string, std::string> Options;
+
+	bool read_options(int argc, char* argv[], const std::string& usage, Options& options);
+	int run_soups(int argc, char* argv[]);
+	int run_hunt(int argc, char* argv[]);
+	int run_sweep(int argc, char* argv[]);
+	int run_enumerate(int argc, char* argv[]);
+	int run_parent(int argc, char* argv[]);
+	int run_render(int argc, char* argv[]);
+} /* unnamed namespace */
 
 //===========================================
 
 int main(int argc, char* argv[]) {
+	if (argc >= 2 && std::string(argv[1]) == "--soups")
+		return run_soups(argc, argv);
+	if (argc >= 2 && std::string(argv[1]) == "--hunt")
+		return run_hunt(argc, argv);
+	if (argc >= 2 && std::string(argv[1]) == "--sweep")
+		return run_sweep(argc, argv);
+	if (argc >= 2 && std::string(argv[1]) == "--enumerate")
+		return run_enumerate(argc, argv);
+	if (argc >= 2 && std::string(argv[1]) == "--parent")
+		return run_parent(argc, argv);
+	if (argc >= 2 && std::string(argv[1]) == "--render")
+		return run_render(argc, argv);
+
 	std::string filename;
 	int result(0);
 	if (argc == 2) {
@@ -47,3 +80,239 @@ int main(int argc, char* argv[]) {
 
 	return app->run(window);
 }
+
+namespace {
+	// Read "--command argument" followed by "--option value" pairs into options
+	bool read_options(int argc, char* argv[], const std::string& usage, Options& options) {
+		if (argc < 3 || argc % 2 == 0) {
+			std::cerr << "usage: " << argv[0] << " " << usage << std::endl;
+			return false;
+		}
+		options["argument"] = argv[2];
+		for (int i(3); i + 1 < argc; i += 2) {
+			const std::string option(argv[i]);
+			if (option.compare(0, 2, "--") != 0 || options.count(option.substr(2)) == 0) {
+				std::cerr << "unknown option " << option << ", usage: " << argv[0] << " "
+						  << usage << std::endl;
+				return false;
+			}
+			options[option.substr(2)] = argv[i + 1];
+		}
+		return true;
+	}
+
+	// gol_lab --soups N [--seed S] [--threads T] : census of N random soups
+	// without opening the window
+	int run_soups(int argc, char* argv[]) {
+		Options options({{"seed", "0"}, {"threads", std::to_string(thread_count())}});
+		if (!read_options(argc, argv, "--soups N [--seed S] [--threads T]", options))
+			return 1;
+		const unsigned long n_threads(std::max(1ul, std::strtoul(options["threads"].c_str(), nullptr, 10)));
+		std::cout << search::format_haul(search::soups(std::strtoull(options["seed"].c_str(), nullptr, 10),
+													   std::strtoul(options["argument"].c_str(), nullptr, 10),
+													   n_threads));
+		return 0;
+	}
+
+	// gol_lab --hunt N [--box B] [--goal lifespan|population] [--seed S]
+	// [--threads T] [--output FILE] : methuselah hunt over N candidates, the
+	// records are written to the output file (standard output by default)
+	int run_hunt(int argc, char* argv[]) {
+		Options options({{"box", std::to_string(hunt_box_size)}, {"goal", "lifespan"},
+						 {"seed", "0"}, {"threads", std::to_string(thread_count())}, {"output", ""}});
+		const std::string usage("--hunt N [--box B] [--goal lifespan|population] [--seed S]"
+								" [--threads T] [--output FILE]");
+		if (!read_options(argc, argv, usage, options))
+			return 1;
+		const unsigned box_size(std::strtoul(options["box"].c_str(), nullptr, 10));
+		if (box_size == 0 || box_size > hunt_board_size / 4
+			|| (options["goal"] != "lifespan" && options["goal"] != "population")) {
+			std::cerr << "usage: " << argv[0] << " " << usage << std::endl;
+			return 1;
+		}
+		std::ofstream file;
+		if (!options["output"].empty()) {
+			file.open(options["output"]);
+			if (!file) {
+				std::cerr << "cannot write " << options["output"] << std::endl;
+				return 1;
+			}
+		}
+		const unsigned long n_threads(std::max(1ul, std::strtoul(options["threads"].c_str(), nullptr, 10)));
+		const search::Hunt hunt(search::hunt(std::strtoull(options["seed"].c_str(), nullptr, 10),
+											 std::strtoul(options["argument"].c_str(), nullptr, 10),
+											 box_size,
+											 options["goal"] == "population" ? search::POPULATION
+																			 : search::LIFESPAN,
+											 n_threads, file.is_open() ? file : std::cout));
+		std::cout << "\n" << search::format_hunt(hunt);
+		return 0;
+	}
+
+	// gol_lab --sweep RULE [--soups N] [--seed S] [--pattern FILE] [--threads T] :
+	// N random soups (16 by default) or the pattern, under the rules around RULE
+	int run_sweep(int argc, char* argv[]) {
+		Options options({{"soups", "16"}, {"seed", "0"}, {"pattern", ""},
+						 {"threads", std::to_string(thread_count())}});
+		const std::string usage("--sweep RULE [--soups N] [--seed S] [--pattern FILE] [--threads T]");
+		if (!read_options(argc, argv, usage, options))
+			return 1;
+		Rule base;
+		if (!parse_rule(options["argument"], base)) {
+			std::cerr << options["argument"] << " is not a B/S rule without B0" << std::endl;
+			return 1;
+		}
+		std::vector<std::vector<Coordinates>> starts;
+		if (!options["pattern"].empty()) {
+			std::string rule;
+			std::vector<Coordinates> cells(simulation::get_rle_data(options["pattern"], rule));
+			unsigned width(0), height(0);
+			for (auto& cell : cells) {
+				width = std::max(width, cell.x + 1);
+				height = std::max(height, cell.y + 1);
+			}
+			if (cells.empty() || width > sweep_board_size / 2 || height > sweep_board_size / 2) {
+				std::cerr << options["pattern"] << " is not an RLE pattern of at most "
+						  << sweep_board_size / 2 << " cells square" << std::endl;
+				return 1;
+			}
+			starts.push_back(cells);
+		} else {
+			const uint64_t seed(std::strtoull(options["seed"].c_str(), nullptr, 10));
+			const unsigned long n_soups(std::strtoul(options["soups"].c_str(), nullptr, 10));
+			for (unsigned long i(0); i < n_soups; ++i) {
+				starts.push_back(search::soup(seed, i));
+			}
+		}
+		const unsigned long n_threads(std::max(1ul, std::strtoul(options["threads"].c_str(), nullptr, 10)));
+		std::cout << search::format_sweep(search::sweep_rules(starts, base, n_threads));
+		return 0;
+	}
+
+	// gol_lab --enumerate WxH [--period P] [--threads T] [--output DIR] : still
+	// lifes (or oscillators up to period P) of a WxH box, saved as RLE files to
+	// the patterns directory by default
+	int run_enumerate(int argc, char* argv[]) {
+		Options options({{"period", "1"}, {"threads", std::to_string(thread_count())},
+						 {"output", working_dir() + PATTERNS_DIR}});
+		const std::string usage("--enumerate WxH [--period P] [--threads T] [--output DIR]");
+		if (!read_options(argc, argv, usage, options))
+			return 1;
+		unsigned width(0), height(0);
+		const std::string& box(options["argument"]);
+		const size_t x(box.find_first_of("xX"));
+		if (x != std::string::npos) {
+			width = std::strtoul(box.substr(0, x).c_str(), nullptr, 10);
+			height = std::strtoul(box.substr(x + 1).c_str(), nullptr, 10);
+		}
+		const unsigned period(std::strtoul(options["period"].c_str(), nullptr, 10));
+		if (width == 0 || width > enumerate_size_max || height == 0 || height > enumerate_size_max
+			|| period == 0 || period > enumerate_period_max) {
+			std::cerr << "usage: " << argv[0] << " " << usage << " with W, H at most "
+					  << enumerate_size_max << " and P at most " << enumerate_period_max << std::endl;
+			return 1;
+		}
+		std::string directory(options["output"]);
+		if (directory.back() != '/')
+			directory += '/';
+		const unsigned long n_threads(std::max(1ul, std::strtoul(options["threads"].c_str(), nullptr, 10)));
+		const search::Enumeration enumeration(search::enumerate(width, height, period, n_threads));
+		std::cout << search::format_enumeration(enumeration);
+		const unsigned n_saved(search::save_enumeration(enumeration, directory));
+		std::cout << n_saved << " patterns written to " << directory << std::endl;
+		return n_saved == enumeration.patterns.size() ? 0 : 1;
+	}
+
+	// gol_lab --parent FILE [--margin M] [--threads T] : parent of the RLE
+	// pattern spreading at most M cells around it (1 by default), the progress
+	// is shown on the standard error
+	int run_parent(int argc, char* argv[]) {
+		Options options({{"margin", "1"}, {"threads", std::to_string(thread_count())}});
+		const std::string usage("--parent FILE [--margin M] [--threads T]");
+		if (!read_options(argc, argv, usage, options))
+			return 1;
+		const std::vector<Coordinates> target(simulation::get_rle_data(options["argument"]));
+		unsigned width(0), height(0);
+		for (auto& cell : target) {
+			width = std::max(width, cell.x + 1);
+			height = std::max(height, cell.y + 1);
+		}
+		const unsigned margin(std::strtoul(options["margin"].c_str(), nullptr, 10));
+		if (margin == 0 || margin > predecessor_margin_max) {
+			std::cerr << "usage: " << argv[0] << " " << usage << " with M from 1 to "
+					  << predecessor_margin_max << std::endl;
+			return 1;
+		}
+		if (target.empty() || std::min(width, height) + 2 * margin > predecessor_width_max) {
+			std::cerr << options["argument"] << " is not a Life pattern whose shorter side is at most "
+					  << predecessor_width_max - 2 * margin << " cells" << std::endl;
+			return 1;
+		}
+		const unsigned long n_threads(std::max(1ul, std::strtoul(options["threads"].c_str(), nullptr, 10)));
+		search::Progress progress;
+		search::Predecessor predecessor;
+		std::atomic<bool> finished(false);
+		std::thread searcher([&]() {
+			predecessor = search::predecessor(target, margin, n_threads, progress);
+			finished = true;
+		});
+		for (unsigned tick(1); !finished; ++tick) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(100));
+			if (tick % 10 == 0 && progress.total != 0)
+				std::cerr << "\r" << 100. * progress.done / progress.total << " %   " << std::flush;
+		}
+		searcher.join();
+		std::cerr << std::endl;
+		std::cout << search::format_predecessor(predecessor);
+		return 0;
+	}
+
+	// gol_lab --render FILE [--threads T] [--tile ROWS] [--repeat N] : time the
+	// image of the RLE pattern drawn by the pixel renderer on 1 to T threads,
+	// in tiles of ROWS rows, N times each (10 by default)
+	int run_render(int argc, char* argv[]) {
+		Options options({{"threads", std::to_string(thread_count())},
+						 {"tile", std::to_string(raster_tile_rows)}, {"repeat", "10"}});
+		const std::string usage("--render FILE [--threads T] [--tile ROWS] [--repeat N]");
+		if (!read_options(argc, argv, usage, options))
+			return 1;
+		std::string rule;
+		const std::vector<Coordinates> cells(simulation::get_rle_data(options["argument"], rule));
+		unsigned width(0), height(0);
+		for (auto& cell : cells) {
+			width = std::max(width, cell.x + 1);
+			height = std::max(height, cell.y + 1);
+		}
+		if (cells.empty()) {
+			std::cerr << options["argument"] << " is not an RLE pattern" << std::endl;
+			return 1;
+		}
+		const unsigned long max_threads(std::max(1ul, std::strtoul(options["threads"].c_str(), nullptr, 10)));
+		const unsigned long tile_rows(std::max(1ul, std::strtoul(options["tile"].c_str(), nullptr, 10)));
+		const unsigned long repeat(std::max(1ul, std::strtoul(options["repeat"].c_str(), nullptr, 10)));
+		const auto draw = [&]() {
+			graphic_rasterize_cells_image(cells, width, height, 0, width - 1, 0, height - 1, false, {}, {});
+			while (graphic_cells_image_busy())
+				std::this_thread::sleep_for(std::chrono::microseconds(100));
+		};
+		std::cout << cells.size() << " cells, " << width << "x" << height << " pixels, tiles of "
+				  << tile_rows << " rows" << std::endl;
+		double single(0);
+		for (unsigned n_threads(1); n_threads <= max_threads; ++n_threads) {
+			graphic_set_raster_tiling(n_threads, tile_rows);
+			// Both images are allocated before timing
+			draw();
+			draw();
+			const auto start(std::chrono::steady_clock::now());
+			for (unsigned long i(0); i < repeat; ++i) {
+				draw();
+			}
+			const double ms(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now()
+																	  - start).count() / repeat);
+			if (n_threads == 1)
+				single = ms;
+			std::cout << n_threads << " threads: " << ms << " ms, speed-up " << single / ms << std::endl;
+		}
+		return 0;
+	}
+} /* unnamed namespace */
@@ -0,0 +1,1599 @@
+/*
+ * search.cc
+ * This file is part of GoL Lab, a simulator of Conway's game of life.
+ *
+ * Copyright (C) 2022-2023 Cyprien Lacassagne
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <iomanip>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include "search.h"
+#include "board.h"
+#include "library.h"
+#include "simulation.h"
+
+namespace {
+    // Board and buffers of a worker thread, reused from one pattern to the next
+    struct Lab {
+        Lab(unsigned width, unsigned height);
+
+        Board board;
+        std::vector<unsigned> populations;
+        // Hashes of the board at each check of the population
+        std::vector<uint64_t> hashes;
+        // apgcodes of the objects met so far, by their cells moved to the origin
+        std::unordered_map<std::string, std::string> known;
+        // apgcodes of the spaceships taken off the board
+        std::vector<std::string> escaped;
+        // apgcodes of the objects left by the last settled pattern, escaped included
+        std::vector<std::string> codes;
+    };
+
+    // A projectile in its first phase, moving by (dx, dy) every 4 generations
+    struct Shape {
+        std::vector<Coordinates> cells;
+        unsigned width;
+        unsigned height;
+        unsigned dx;
+        unsigned dy;
+    };
+
+    // One orientation of a collision target, its phases in the same bounding box
+    struct Target {
+        std::vector<std::vector<Coordinates>> phases;
+        unsigned width;
+        unsigned height;
+    };
+
+    // A collision to run. The lane is x - y of the glider or y of the *WSS.
+    struct Shot {
+        unsigned orientation;
+        int lane;
+        unsigned phase;
+        // Cells the projectile is moved back along its path
+        unsigned shift;
+    };
+
+    enum ShotOutcome { SHOT_MISSED, SHOT_UNSETTLED, SHOT_SETTLED };
+
+    // Backtracking state of the enumeration of the patterns of a box that come
+    // back after period generations. Cell x of a row is bit x + 1, bits 0 and
+    // width + 1 are the dead cells beside the box.
+    struct Enumerator {
+        Enumerator(unsigned width, unsigned height, unsigned period);
+
+        unsigned width;
+        unsigned height;
+        unsigned period;
+        uint64_t mask;
+        // Phase t of row r is rows[r * period + t], decisions are made in this order
+        std::vector<uint64_t> rows;
+        // Rows that can come below a row, by the row above it, the row and its
+        // next phase packed in a key
+        std::unordered_map<uint64_t, std::vector<uint64_t>> extensions;
+        // Patterns found, by the description of their canonical phase and orientation
+        std::map<std::string, std::vector<Coordinates>> found;
+        unsigned long n_nodes;
+    };
+
+    // Rows chosen up to a decision, searched by a thread or stolen by another
+    struct Task {
+        std::vector<uint64_t> rows;
+        unsigned decision;
+    };
+
+    struct RowPairHash {
+        size_t operator()(const std::pair<uint64_t, uint64_t>& rows) const;
+    };
+
+    // Backtracking state of a parent search. The parent and the target are
+    // transposed if the target is wider than high. Cell x of a row is bit x + 1.
+    struct ParentSearch {
+        ParentSearch(const std::vector<Coordinates>& target, unsigned margin,
+                     search::Progress& progress, std::atomic<bool>& found);
+
+        // Of the parent, the target sits margin cells inside
+        unsigned width;
+        unsigned height;
+        bool transposed;
+        // Next generation wanted, in the coordinates of the parent. Only the
+        // cells with all their neighbours in the parent are checked.
+        std::vector<uint64_t> target;
+        std::vector<uint64_t> rows;
+        // Whether a cell with these 9 neighbours, row by row, is alive next
+        std::array<bool, 512> next_cell;
+        // Rows y - 1 and y of the parent after which no row y + 1 works, by y
+        std::vector<std::unordered_set<std::pair<uint64_t, uint64_t>, RowPairHash>> dead_ends;
+        unsigned long n_dead_ends;
+        unsigned long n_nodes;
+        // First cell of the search of a task, and the progress of the task reported
+        unsigned first;
+        unsigned long reported;
+        search::Progress& progress;
+        std::atomic<bool>& found;
+        // Set once the search is cancelled or a parent is found elsewhere
+        bool halted;
+    };
+
+    struct Outcome {
+        // Generation from which the population is periodic
+        unsigned long lifespan;
+        bool settled;
+        // Something other than a spaceship reached the edge of the board
+        bool overflow;
+    };
+
+    uint64_t mix(uint64_t z);
+    void load(Lab& lab, const std::vector<Coordinates>& cells, unsigned x, unsigned y);
+    Outcome settle(Lab& lab, unsigned long generations_max);
+    unsigned population_period(const std::vector<unsigned>& populations, size_t window);
+    unsigned board_period(const std::vector<uint64_t>& hashes);
+    unsigned long periodic_since(const std::vector<unsigned>& populations, unsigned period);
+    bool remove_escapees(Lab& lab);
+    bool identify_objects(Lab& lab);
+    std::string identify(Lab& lab, const std::vector<Coordinates>& object);
+    void remove_spaceships(Lab& lab);
+    Shape projectile_shape(search::Projectile projectile);
+    std::vector<Target> orientations(const std::vector<Coordinates>& target);
+    std::pair<int, int> lanes(const Target& target, const Shape& shape);
+    ShotOutcome fire(Lab& lab, const Target& target, const Shape& shape, const Shot& shot,
+                     search::Collision& collision, std::string& key);
+    bool row_order(const Coordinates& a, const Coordinates& b);
+    std::string describe(const std::vector<std::string>& codes);
+    std::vector<Coordinates> candidate(const std::vector<search::Methuselah>& pool, uint64_t seed,
+                                       unsigned long index, unsigned box_size);
+    bool evaluate(Lab& lab, search::Methuselah& methuselah, unsigned box_size);
+    bool better(const search::Methuselah& a, const search::Methuselah& b, search::HuntGoal goal);
+    std::string describe(const search::Methuselah& methuselah);
+    search::RuleClass run_rule(Lab& lab, const std::vector<Coordinates>& start, const Rule& rule);
+    void enumerate_period(unsigned width, unsigned height, unsigned period, unsigned n_threads,
+                          std::map<std::string, std::vector<Coordinates>>& found,
+                          unsigned long& n_nodes);
+    bool take_task(std::vector<std::deque<Task>>& queues, std::vector<std::mutex>& locks,
+                   unsigned t, Task& task);
+    const std::vector<uint64_t>& extensions(Enumerator& enumerator, unsigned decision);
+    bool consistent(const Enumerator& enumerator, unsigned decision);
+    void descend(Enumerator& enumerator, unsigned decision);
+    void keep(Enumerator& enumerator);
+    bool strict_still_life(const Enumerator& enumerator);
+    bool stable(const Enumerator& enumerator, const std::vector<uint64_t>& rows);
+    std::vector<Coordinates> orient(const std::vector<Coordinates>& cells, unsigned orientation);
+    std::string cells_key(const std::vector<Coordinates>& cells);
+    bool choose(ParentSearch& parent, unsigned y, unsigned x);
+    bool fits(const ParentSearch& parent, unsigned y, unsigned x);
+    bool stopped(ParentSearch& parent);
+    void report(ParentSearch& parent, unsigned long progress);
+} /* unnamed namespace */
+
+search::Haul search::soups(uint64_t seed, unsigned long n_soups, unsigned n_threads) {
+    const auto start(std::chrono::steady_clock::now());
+    std::atomic<unsigned long> next_soup(0);
+    std::vector<std::map<std::string, unsigned long>> tallies(n_threads);
+    std::vector<std::vector<Find>> finds(n_threads);
+
+    std::vector<std::thread> workers;
+    for (unsigned t(0); t < n_threads; ++t) {
+        workers.emplace_back([&, t]() {
+            Lab lab(soup_board_size, soup_board_size);
+            const unsigned offset((soup_board_size - soup_size) / 2);
+            for (;;) {
+                const unsigned long first(next_soup.fetch_add(soup_batch));
+                if (first >= n_soups)
+                    break;
+                const unsigned long last(std::min(first + soup_batch, n_soups));
+                for (unsigned long i(first); i < last; ++i) {
+                    load(lab, soup(seed, i), offset, offset);
+                    const Outcome outcome(settle(lab, settle_generations_max));
+                    if (!outcome.settled) {
+                        finds[t].push_back({outcome.overflow ? "overflow" : "unsettled", i});
+                        continue;
+                    }
+                    for (auto& code : lab.codes) {
+                        ++tallies[t][code];
+                        if (is_rare(code))
+                            finds[t].push_back({code, i});
+                    }
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    Haul haul({seed, n_soups, {}, {}, 0});
+    std::map<std::string, unsigned long> tally;
+    for (auto& thread_tally : tallies) {
+        for (auto& entry : thread_tally) {
+            tally[entry.first] += entry.second;
+        }
+    }
+    for (auto& entry : tally) {
+        haul.objects.push_back({entry.first, census::object_name(entry.first),
+                                (unsigned)entry.second});
+    }
+    std::stable_sort(haul.objects.begin(), haul.objects.end(),
+                     [](const census::Object& a, const census::Object& b) {
+        return a.count > b.count;
+    });
+    for (auto& thread_finds : finds) {
+        haul.finds.insert(haul.finds.end(), thread_finds.begin(), thread_finds.end());
+    }
+    std::sort(haul.finds.begin(), haul.finds.end(), [](const Find& a, const Find& b) {
+        return a.soup < b.soup || (a.soup == b.soup && a.apgcode < b.apgcode);
+    });
+    haul.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return haul;
+}
+
+std::vector<Coordinates> search::soup(uint64_t seed, unsigned long index) {
+    std::vector<Coordinates> cells;
+    uint64_t state(mix(seed) ^ index);
+    for (unsigned word(0); word < soup_size * soup_size / 64; ++word) {
+        uint64_t bits(mix(state += 0x9e3779b97f4a7c15));
+        while (bits != 0) {
+            const unsigned cell(word * 64 + __builtin_ctzll(bits));
+            cells.push_back({cell % soup_size, cell / soup_size});
+            bits &= bits - 1;
+        }
+    }
+    return cells;
+}
+
+bool search::is_rare(const std::string& apgcode) {
+    const std::string prefix(apgcode.substr(0, 2));
+    const unsigned number(std::strtoul(apgcode.c_str() + 2, nullptr, 10));
+    if (prefix == "xs")
+        return number >= rare_population_min;
+    if (prefix == "xp")
+        return number >= 3;
+    if (prefix == "xq")
+        return apgcode != "xq4_153";
+    return true;
+}
+
+std::string search::format_haul(const Haul& haul) {
+    std::ostringstream text;
+    text << haul.n_soups << " soups of seed " << haul.seed << " in " << std::fixed
+         << std::setprecision(2) << haul.seconds << " s ("
+         << std::setprecision(0) << haul.n_soups / std::max(haul.seconds, 1e-9)
+         << " soups/s)\n\n";
+    text << census::format_table(haul.objects);
+    if (haul.finds.empty())
+        return text.str();
+
+    text << "\n" << haul.finds.size() << " rare finds\n";
+    for (auto& find : haul.finds) {
+        text << "\n" << find.apgcode << " in soup " << find.soup << "\n"
+             << simulation::encode_rle(soup(haul.seed, find.soup));
+    }
+    return text.str();
+}
+
+search::CollisionSearch search::collide(const std::vector<Coordinates>& target,
+                                       Projectile projectile, unsigned n_threads,
+                                       Progress& progress) {
+    const auto start(std::chrono::steady_clock::now());
+    CollisionSearch search({projectile, 0, 0, 0, 0, {}, 0});
+    const std::vector<Target> targets(orientations(target));
+    const Shape shape(projectile_shape(projectile));
+    std::vector<Shot> shots;
+    for (unsigned orientation(0); orientation < targets.size(); ++orientation) {
+        const std::pair<int, int> range(lanes(targets[orientation], shape));
+        for (int lane(range.first); lane <= range.second; ++lane) {
+            for (unsigned phase(0); phase < targets[orientation].phases.size(); ++phase) {
+                // A glider moved back by one cell is the same glider 4 generations
+                // earlier, a *WSS is so only if it is moved back by two
+                for (unsigned shift(0); shift < std::max(shape.dx, shape.dy); ++shift) {
+                    shots.push_back({orientation, lane, phase, shift});
+                }
+            }
+        }
+    }
+    if (!targets.empty())
+        search.target_period = targets.front().phases.size();
+    search.n_tried = shots.size();
+    progress.total = shots.size();
+
+    // Results of the shots that settled, with their index to keep the first
+    // collision of each result whatever the number of threads
+    struct Result {
+        size_t shot;
+        std::string key;
+        Collision collision;
+    };
+    std::atomic<size_t> next_shot(0);
+    std::vector<std::vector<Result>> results(n_threads);
+    std::vector<unsigned long> misses(n_threads, 0), unsettled(n_threads, 0);
+    std::vector<std::thread> workers;
+    for (unsigned t(0); t < n_threads; ++t) {
+        workers.emplace_back([&, t]() {
+            Lab lab(collision_board_size, collision_board_size);
+            for (size_t i(next_shot++); i < shots.size() && !progress.cancel; i = next_shot++) {
+                Result result({i, "", {}});
+                switch (fire(lab, targets[shots[i].orientation], shape, shots[i],
+                             result.collision, result.key)) {
+                case SHOT_MISSED:
+                    ++misses[t];
+                    break;
+                case SHOT_UNSETTLED:
+                    ++unsettled[t];
+                    break;
+                case SHOT_SETTLED:
+                    results[t].push_back(result);
+                }
+                ++progress.done;
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    std::vector<Result> all;
+    for (unsigned t(0); t < n_threads; ++t) {
+        search.n_misses += misses[t];
+        search.n_unsettled += unsettled[t];
+        all.insert(all.end(), results[t].begin(), results[t].end());
+    }
+    std::sort(all.begin(), all.end(), [](const Result& a, const Result& b) {
+        return a.shot < b.shot;
+    });
+    std::unordered_map<std::string, size_t> seen;
+    for (auto& result : all) {
+        auto it(seen.find(result.key));
+        if (it != seen.end()) {
+            ++search.collisions[it->second].count;
+            continue;
+        }
+        seen[result.key] = search.collisions.size();
+        search.collisions.push_back(result.collision);
+    }
+    std::stable_sort(search.collisions.begin(), search.collisions.end(),
+                     [](const Collision& a, const Collision& b) {
+        if (a.result != b.result)
+            return a.result < b.result;
+        if (a.objects.size() != b.objects.size())
+            return a.objects.size() < b.objects.size();
+        return a.lifespan < b.lifespan;
+    });
+    search.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return search;
+}
+
+std::string search::format_collisions(const CollisionSearch& search) {
+    static const char* projectile_names[] = { "Glider", "LWSS", "MWSS", "HWSS" };
+    static const char* result_names[] = { "Clean", "Debris", "Emission" };
+    std::ostringstream text;
+    if (search.target_period == 0) {
+        text << "The target must be a still life or an oscillator of period " << settle_period_max
+             << " at most, in a " << collision_target_size_max << " cell square.\n";
+        return text.str();
+    }
+    text << projectile_names[search.projectile] << " at a target of period "
+         << search.target_period << ": " << search.n_tried << " collisions, "
+         << search.n_misses << " misses, " << search.n_unsettled << " unsettled, "
+         << search.collisions.size() << " distinct results in " << std::fixed
+         << std::setprecision(2) << search.seconds << " s\n";
+    for (auto& collision : search.collisions) {
+        text << "\n" << result_names[collision.result] << " (" << collision.count
+             << " collisions): " << describe(collision.objects);
+        if (!collision.emitted.empty())
+            text << ", emits " << describe(collision.emitted);
+        text << ", settles after " << collision.lifespan << " generations\n"
+             << simulation::encode_rle(collision.cells);
+    }
+    return text.str();
+}
+
+search::Hunt search::hunt(uint64_t seed, unsigned long n_candidates, unsigned box_size,
+                          HuntGoal goal, unsigned n_threads, std::ostream& records) {
+    const auto start(std::chrono::steady_clock::now());
+    Hunt hunt({seed, n_candidates, box_size, goal, 0, {}, 0});
+    std::vector<Lab> labs;
+    for (unsigned t(0); t < n_threads; ++t) {
+        labs.emplace_back(hunt_board_size, hunt_board_size);
+    }
+    std::vector<uint64_t> best_hashes;
+    std::vector<Methuselah> batch;
+    std::vector<char> settled;
+
+    // The pool only changes between two batches, so that the same seed gives
+    // the same candidates whatever the number of threads
+    for (unsigned long first(0); first < n_candidates; first += hunt_batch) {
+        const size_t n(std::min<unsigned long>(hunt_batch, n_candidates - first));
+        batch.resize(n);
+        settled.assign(n, false);
+        for (size_t i(0); i < n; ++i) {
+            batch[i] = {candidate(hunt.best, seed, first + i, box_size), 0, 0};
+        }
+        std::atomic<size_t> next_candidate(0);
+        std::vector<std::thread> workers;
+        for (unsigned t(0); t < n_threads; ++t) {
+            workers.emplace_back([&, t]() {
+                for (size_t i(next_candidate++); i < n; i = next_candidate++) {
+                    settled[i] = evaluate(labs[t], batch[i], box_size);
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        for (size_t i(0); i < n; ++i) {
+            if (!settled[i]) {
+                ++hunt.n_unsettled;
+                continue;
+            }
+            if (hunt.best.size() == hunt_pool_size && !better(batch[i], hunt.best.back(), goal))
+                continue;
+            const uint64_t hash(library::canonical_hash(batch[i].cells));
+            if (std::find(best_hashes.begin(), best_hashes.end(), hash) != best_hashes.end())
+                continue;
+            size_t rank(0);
+            while (rank < hunt.best.size() && !better(batch[i], hunt.best[rank], goal)) {
+                ++rank;
+            }
+            hunt.best.insert(hunt.best.begin() + rank, batch[i]);
+            best_hashes.insert(best_hashes.begin() + rank, hash);
+            if (hunt.best.size() > hunt_pool_size) {
+                hunt.best.pop_back();
+                best_hashes.pop_back();
+            }
+            records << describe(batch[i]);
+        }
+        records.flush();
+    }
+    hunt.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return hunt;
+}
+
+std::string search::format_hunt(const Hunt& hunt) {
+    std::ostringstream text;
+    text << hunt.n_candidates << " candidates in a " << hunt.box_size << "x" << hunt.box_size
+         << " box of seed " << hunt.seed << " in " << std::fixed << std::setprecision(2)
+         << hunt.seconds << " s (" << std::setprecision(0)
+         << hunt.n_candidates / std::max(hunt.seconds, 1e-9) << " candidates/s), "
+         << hunt.n_unsettled << " unsettled\n";
+    for (auto& methuselah : hunt.best) {
+        text << "\n" << describe(methuselah);
+    }
+    return text.str();
+}
+
+search::RuleSweep search::sweep_rules(const std::vector<std::vector<Coordinates>>& starts,
+                                      const Rule& base, unsigned n_threads) {
+    const auto start(std::chrono::steady_clock::now());
+    RuleSweep sweep({base, starts.size(), {}, 0});
+    for (unsigned row(0); row < sweep_rows; ++row) {
+        for (unsigned column(0); column < sweep_columns; ++column) {
+            Rule rule(base);
+            if (row > 0)
+                rule.birth ^= 1 << row;
+            if (column > 0)
+                rule.survival ^= 1 << (column - 1);
+            sweep.runs.push_back({rule, {}});
+        }
+    }
+
+    const size_t n_runs(sweep.runs.size() * starts.size());
+    std::atomic<size_t> next_run(0);
+    std::vector<std::vector<RuleRuns>> counts(n_threads, sweep.runs);
+    std::vector<std::thread> workers;
+    for (unsigned t(0); t < n_threads; ++t) {
+        workers.emplace_back([&, t]() {
+            Lab lab(sweep_board_size, sweep_board_size);
+            for (size_t i(next_run++); i < n_runs; i = next_run++) {
+                RuleRuns& runs(counts[t][i / starts.size()]);
+                ++runs.counts[run_rule(lab, starts[i % starts.size()], runs.rule)];
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    for (auto& thread_counts : counts) {
+        for (size_t r(0); r < sweep.runs.size(); ++r) {
+            for (unsigned c(0); c < N_RULE_CLASSES; ++c) {
+                sweep.runs[r].counts[c] += thread_counts[r].counts[c];
+            }
+        }
+    }
+    sweep.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return sweep;
+}
+
+std::string search::format_sweep(const RuleSweep& sweep) {
+    static const char* class_names[] = { "Dies", "Stabilizes", "Oscillates", "Explodes", "Chaotic" };
+    static const char class_letters[] = "DSOEC";
+    std::ostringstream text;
+    text << "Rules around " << rule_name(sweep.base) << ", " << sweep.n_starts << " starts in "
+         << std::fixed << std::setprecision(2) << sweep.seconds << " s\n\n"
+         << "Most frequent outcome: D dies, S stabilizes, O oscillates, E explodes, C chaotic\n"
+         << "Rows toggle a birth count of the rule, columns a survival count\n\n    ";
+    for (unsigned column(0); column < sweep_columns; ++column) {
+        text << std::setw(3) << (column == 0 ? "-" : "S" + std::to_string(column - 1));
+    }
+    text << "\n";
+    for (unsigned row(0); row < sweep_rows; ++row) {
+        text << std::left << std::setw(4) << (row == 0 ? "-" : "B" + std::to_string(row))
+             << std::right;
+        for (unsigned column(0); column < sweep_columns; ++column) {
+            const auto& counts(sweep.runs[row * sweep_columns + column].counts);
+            const size_t most(std::max_element(counts.begin(), counts.end()) - counts.begin());
+            text << std::setw(3) << class_letters[most];
+        }
+        text << "\n";
+    }
+
+    text << "\n" << std::left << std::setw(22) << "Rule" << std::right;
+    for (auto name : class_names) {
+        text << std::setw(12) << name;
+    }
+    text << "\n";
+    for (auto& runs : sweep.runs) {
+        text << std::left << std::setw(22) << rule_name(runs.rule) << std::right;
+        for (auto count : runs.counts) {
+            text << std::setw(12) << count;
+        }
+        text << "\n";
+    }
+    return text.str();
+}
+
+search::Enumeration search::enumerate(unsigned width, unsigned height, unsigned period,
+                                      unsigned n_threads) {
+    const auto start(std::chrono::steady_clock::now());
+    Enumeration enumeration({width, height, period, {}, 0, 0});
+    std::map<std::string, std::vector<Coordinates>> found;
+    // The search of a period also finds the patterns of its divisors, only
+    // those of that exact period are kept
+    for (unsigned p(period == 1 ? 1 : 2); p <= period; ++p) {
+        enumerate_period(width, height, p, n_threads, found, enumeration.n_nodes);
+    }
+    for (auto& entry : found) {
+        enumeration.patterns.push_back({census::apgcode(entry.second), entry.second});
+    }
+    std::sort(enumeration.patterns.begin(), enumeration.patterns.end(),
+              [](const Enumerated& a, const Enumerated& b) {
+        return a.apgcode < b.apgcode;
+    });
+    enumeration.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return enumeration;
+}
+
+unsigned search::save_enumeration(const Enumeration& enumeration, std::string directory) {
+    unsigned n_saved(0);
+    for (auto& pattern : enumeration.patterns) {
+        std::ofstream file(directory + pattern.apgcode + ".rle");
+        if (!file)
+            continue;
+        const std::string name(census::object_name(pattern.apgcode));
+        file << "#N " << (name.empty() ? pattern.apgcode : name) << "\n"
+             << "#C " << (pattern.apgcode.compare(0, 2, "xs") == 0 ? "Still life" : "Oscillator")
+             << " enumerated by GoL Lab in a " << enumeration.width << "x" << enumeration.height
+             << " box.\n" << simulation::encode_rle(pattern.cells);
+        ++n_saved;
+    }
+    return n_saved;
+}
+
+std::string search::format_enumeration(const Enumeration& enumeration) {
+    std::ostringstream text;
+    text << enumeration.patterns.size();
+    if (enumeration.period == 1)
+        text << " still lifes";
+    else
+        text << " oscillators of period 2 to " << enumeration.period;
+    text << " in a " << enumeration.width << "x" << enumeration.height << " box, "
+         << enumeration.n_nodes << " nodes in " << std::fixed << std::setprecision(2)
+         << enumeration.seconds << " s\n\n";
+    for (auto& pattern : enumeration.patterns) {
+        text << std::left << std::setw(26) << census::object_name(pattern.apgcode)
+             << pattern.apgcode << "\n";
+    }
+    return text.str();
+}
+
+search::Progress::Progress()
+:   done(0),
+    total(0),
+    cancel(false) {}
+
+search::Predecessor search::predecessor(const std::vector<Coordinates>& target, unsigned margin,
+                                        unsigned n_threads, Progress& progress) {
+    const auto start(std::chrono::steady_clock::now());
+    Predecessor predecessor({NO_PARENT, margin, {}, 0, 0});
+    std::atomic<bool> found(false);
+    const ParentSearch model(target, margin, progress, found);
+    const unsigned n_cells(model.width * model.height);
+    const unsigned split(std::min(predecessor_split_cells, n_cells));
+    const unsigned long n_tasks(1ul << split);
+    const unsigned long task_work(1ul << predecessor_progress_cells);
+    progress.total = n_tasks * task_work;
+
+    // Task i sets cell c of the parent, in the order of the search, to bit c of i
+    std::atomic<unsigned long> next_task(0);
+    std::mutex lock;
+    std::vector<unsigned long> nodes(n_threads, 0);
+    std::vector<std::thread> workers;
+    for (unsigned t(0); t < n_threads; ++t) {
+        workers.emplace_back([&, t]() {
+            ParentSearch parent(model);
+            for (unsigned long i(next_task++); i < n_tasks && !stopped(parent); i = next_task++) {
+                bool possible(true);
+                for (unsigned c(0); c < split && possible; ++c) {
+                    const unsigned y(c / parent.width), x(c % parent.width);
+                    parent.rows[y] = (parent.rows[y] & ~(2ull << x)) | (i >> c & 1) << (x + 1);
+                    possible = fits(parent, y, x);
+                }
+                parent.first = split;
+                parent.reported = 0;
+                if (possible && choose(parent, (split - 1) / parent.width,
+                                       (split - 1) % parent.width + 1)) {
+                    std::lock_guard<std::mutex> guard(lock);
+                    if (!found) {
+                        found = true;
+                        predecessor.cells.clear();
+                        for (unsigned y(0); y < parent.height; ++y) {
+                            for (unsigned x(0); x < parent.width; ++x) {
+                                if (parent.rows[y] >> (x + 1) & 1)
+                                    predecessor.cells.push_back(parent.transposed ? Coordinates({y, x})
+                                                                                  : Coordinates({x, y}));
+                            }
+                        }
+                        std::sort(predecessor.cells.begin(), predecessor.cells.end(), row_order);
+                    }
+                }
+                report(parent, task_work);
+            }
+            nodes[t] = parent.n_nodes;
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    for (auto n : nodes) {
+        predecessor.n_nodes += n;
+    }
+    if (found)
+        predecessor.result = PARENT_FOUND;
+    else if (progress.cancel)
+        predecessor.result = SEARCH_CANCELLED;
+    predecessor.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return predecessor;
+}
+
+std::string search::format_predecessor(const Predecessor& predecessor) {
+    std::ostringstream text;
+    switch (predecessor.result) {
+    case PARENT_FOUND:
+        text << "Parent found";
+        break;
+    case NO_PARENT:
+        if (predecessor.margin == 1)
+            text << "No parent: the pattern is an orphan, any pattern holding it is a Garden of Eden";
+        else
+            text << "No parent within " << predecessor.margin << " cells";
+        break;
+    case SEARCH_CANCELLED:
+        text << "Search cancelled";
+    }
+    text << ", " << predecessor.n_nodes << " nodes in " << std::fixed << std::setprecision(2)
+         << predecessor.seconds << " s\n";
+    if (predecessor.result == PARENT_FOUND)
+        text << "\n" << simulation::encode_rle(predecessor.cells);
+    return text.str();
+}
+
+namespace {
+    Lab::Lab(unsigned width, unsigned height)
+    :   board(width, height) {}
+
+    // SplitMix64 finalizer
+    uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    }
+
+    // Clear the board and put the cells on it, shifted by (x, y)
+    void load(Lab& lab, const std::vector<Coordinates>& cells, unsigned x, unsigned y) {
+        lab.board.clear();
+        lab.escaped.clear();
+        for (auto& cell : cells) {
+            lab.board.set(x + cell.x, y + cell.y);
+        }
+    }
+
+    // Evolve the board until it comes back exactly, or until its population
+    // repeats and every object left is periodic. Spaceships flying away are
+    // taken off the board on the way.
+    Outcome settle(Lab& lab, unsigned long generations_max) {
+        lab.populations.clear();
+        lab.hashes.clear();
+        lab.codes.clear();
+        lab.populations.push_back(lab.board.population());
+        unsigned long next_check(0);
+        for (unsigned long generation(1); generation <= generations_max; ++generation) {
+            lab.board.step();
+            if (lab.board.near_edge(settle_edge_margin) && !remove_escapees(lab))
+                return {generation, false, true};
+            const unsigned population(lab.board.population());
+            lab.populations.push_back(population);
+            if (population == 0) {
+                lab.codes = lab.escaped;
+                return {generation, true, false};
+            }
+            if (generation % settle_check_interval != 0)
+                continue;
+            // A board that came back as it was cannot change anymore, there is
+            // no need to wait for the population to repeat for long
+            lab.hashes.push_back(lab.board.hash());
+            const unsigned repeat(board_period(lab.hashes) * settle_check_interval);
+            if (repeat != 0) {
+                const unsigned cycle(population_period(lab.populations, repeat));
+                if (cycle != 0 && identify_objects(lab))
+                    return {periodic_since(lab.populations, cycle), true, false};
+            }
+            if (generation < next_check)
+                continue;
+            const unsigned period(population_period(lab.populations, settle_window));
+            if (period == 0)
+                continue;
+            const unsigned long since(periodic_since(lab.populations, period));
+            // An object the census cannot classify must not hold the pattern forever
+            if (identify_objects(lab) || generation - since >= 2 * settle_window)
+                return {since, true, false};
+            next_check = generation + settle_window / 4;
+        }
+        return {generations_max, false, false};
+    }
+
+    // @return The smallest period of the last window populations, 0 if none.
+    unsigned population_period(const std::vector<unsigned>& populations, size_t window) {
+        const size_t n(populations.size());
+        if (n < window + settle_period_max)
+            return 0;
+        for (unsigned period(1); period <= settle_period_max; ++period) {
+            size_t i(n - window);
+            while (i < n && populations[i] == populations[i - period]) {
+                ++i;
+            }
+            if (i == n)
+                return period;
+        }
+        return 0;
+    }
+
+    // @return The smallest number of checks after which the board came back, 0 if
+    // none within settle_window generations.
+    unsigned board_period(const std::vector<uint64_t>& hashes) {
+        const size_t n(hashes.size());
+        for (unsigned checks(1); checks < n && checks * settle_check_interval <= settle_window;
+             ++checks) {
+            if (hashes[n - 1] == hashes[n - 1 - checks])
+                return checks;
+        }
+        return 0;
+    }
+
+    unsigned long periodic_since(const std::vector<unsigned>& populations, unsigned period) {
+        size_t i(populations.size() - 1);
+        while (i >= period && populations[i] == populations[i - period]) {
+            --i;
+        }
+        return i < period ? 0 : i - period + 1;
+    }
+
+    // Take the spaceships close to the edge off the board
+    // @return false if another object is close to the edge.
+    bool remove_escapees(Lab& lab) {
+        const unsigned width(lab.board.get_width());
+        const unsigned height(lab.board.get_height());
+        for (auto& object : census::split(lab.board.live_cells())) {
+            bool at_edge(false);
+            for (auto& cell : object) {
+                if (cell.x < settle_edge_margin || cell.x + settle_edge_margin >= width
+                    || cell.y < settle_edge_margin || cell.y + settle_edge_margin >= height)
+                    at_edge = true;
+            }
+            if (!at_edge)
+                continue;
+            const std::string code(identify(lab, object));
+            if (code.compare(0, 2, "xq") != 0)
+                return false;
+            for (auto& cell : object) {
+                lab.board.set(cell.x, cell.y, false);
+            }
+            lab.escaped.push_back(code);
+        }
+        return true;
+    }
+
+    // Fill lab.codes with the objects of the board
+    // @return false if one of them is not periodic.
+    bool identify_objects(Lab& lab) {
+        lab.codes = lab.escaped;
+        bool periodic(true);
+        for (auto& object : census::split(lab.board.live_cells())) {
+            lab.codes.push_back(identify(lab, object));
+            if (lab.codes.back().compare(0, 2, "zz") == 0)
+                periodic = false;
+        }
+        return periodic;
+    }
+
+    std::string identify(Lab& lab, const std::vector<Coordinates>& object) {
+        unsigned x_min(object.front().x), x_max(x_min), y_min(object.front().y), y_max(y_min);
+        for (auto& cell : object) {
+            x_min = std::min(x_min, cell.x);
+            x_max = std::max(x_max, cell.x);
+            y_min = std::min(y_min, cell.y);
+            y_max = std::max(y_max, cell.y);
+        }
+        if (x_max - x_min >= census_object_size_max || y_max - y_min >= census_object_size_max)
+            return census::apgcode(object);
+
+        // The cells of an object come row by row, they fit in a byte once moved
+        std::string key;
+        for (auto& cell : object) {
+            key += (char)(cell.x - x_min);
+            key += (char)(cell.y - y_min);
+        }
+        auto it(lab.known.find(key));
+        if (it == lab.known.end())
+            it = lab.known.insert({key, census::apgcode(object)}).first;
+        return it->second;
+    }
+
+    void remove_spaceships(Lab& lab) {
+        for (auto& object : census::split(lab.board.live_cells())) {
+            const std::string code(identify(lab, object));
+            if (code.compare(0, 2, "xq") != 0)
+                continue;
+            for (auto& cell : object) {
+                lab.board.set(cell.x, cell.y, false);
+            }
+            lab.escaped.push_back(code);
+        }
+    }
+
+    Shape projectile_shape(search::Projectile projectile) {
+        static const std::vector<std::vector<std::string>> drawings({
+            { ".O.", "..O", "OOO" },
+            { "O..O.", "....O", "O...O", ".OOOO" },
+            { "..O...", "O...O.", ".....O", "O....O", ".OOOOO" },
+            { "..OO...", "O....O.", "......O", "O.....O", ".OOOOOO" },
+        });
+        const std::vector<std::string>& drawing(drawings[projectile]);
+        Shape shape({{}, (unsigned)drawing.front().size(), (unsigned)drawing.size(),
+                     projectile == search::GLIDER ? 1u : 2u, projectile == search::GLIDER ? 1u : 0u});
+        for (unsigned y(0); y < shape.height; ++y) {
+            for (unsigned x(0); x < shape.width; ++x) {
+                if (drawing[y][x] == 'O')
+                    shape.cells.push_back({x, y});
+            }
+        }
+        return shape;
+    }
+
+    // The distinct orientations of the target, none if it is not periodic or too large
+    std::vector<Target> orientations(const std::vector<Coordinates>& target) {
+        std::vector<Target> targets;
+        if (target.empty())
+            return targets;
+        unsigned x_min(target.front().x), x_max(x_min), y_min(target.front().y), y_max(y_min);
+        for (auto& cell : target) {
+            x_min = std::min(x_min, cell.x);
+            x_max = std::max(x_max, cell.x);
+            y_min = std::min(y_min, cell.y);
+            y_max = std::max(y_max, cell.y);
+        }
+        if (x_max - x_min >= collision_target_size_max || y_max - y_min >= collision_target_size_max)
+            return targets;
+
+        // Phases of the target until it comes back, on a board where its sparks fit
+        const unsigned center(collision_board_size / 2 - collision_target_size_max / 2);
+        Board board(collision_board_size, collision_board_size);
+        for (auto& cell : target) {
+            board.set(center + cell.x - x_min, center + cell.y - y_min);
+        }
+        const uint64_t first(board.hash());
+        std::vector<std::vector<Coordinates>> phases;
+        do {
+            phases.push_back(board.live_cells());
+            board.step();
+        } while (board.hash() != first && phases.size() <= settle_period_max);
+        if (board.hash() != first)
+            return targets;
+
+        Coordinates low(phases.front().front()), high(low);
+        for (auto& phase : phases) {
+            for (auto& cell : phase) {
+                low = {std::min(low.x, cell.x), std::min(low.y, cell.y)};
+                high = {std::max(high.x, cell.x), std::max(high.y, cell.y)};
+            }
+        }
+        const unsigned width(high.x - low.x + 1);
+        const unsigned height(high.y - low.y + 1);
+
+        std::vector<std::string> seen;
+        for (unsigned orientation(0); orientation < 8; ++orientation) {
+            const bool transpose(orientation & 4);
+            Target oriented({{}, transpose ? height : width, transpose ? width : height});
+            std::vector<std::string> keys;
+            for (auto& phase : phases) {
+                std::vector<Coordinates> cells;
+                for (auto& cell : phase) {
+                    unsigned u(cell.x - low.x);
+                    unsigned v(cell.y - low.y);
+                    if (transpose)
+                        std::swap(u, v);
+                    if (orientation & 1)
+                        u = oriented.width - 1 - u;
+                    if (orientation & 2)
+                        v = oriented.height - 1 - v;
+                    cells.push_back({u, v});
+                }
+                std::sort(cells.begin(), cells.end(), row_order);
+                keys.push_back(cells_key(cells));
+                oriented.phases.push_back(cells);
+            }
+            // A symmetric target gives the same phases in several orientations
+            std::sort(keys.begin(), keys.end());
+            std::string key;
+            for (auto& phase_key : keys) {
+                key += phase_key + ";";
+            }
+            if (std::find(seen.begin(), seen.end(), key) != seen.end())
+                continue;
+            seen.push_back(key);
+            targets.push_back(oriented);
+        }
+        return targets;
+    }
+
+    // @return The first and last lanes where the projectile may touch the target.
+    std::pair<int, int> lanes(const Target& target, const Shape& shape) {
+        const int x0((collision_board_size - target.width) / 2);
+        const int y0((collision_board_size - target.height) / 2);
+        const int x1(x0 + target.width - 1);
+        const int y1(y0 + target.height - 1);
+        const int margin(collision_lane_margin);
+        if (shape.dy != 0)
+            return {x0 - y1 - (int)shape.height - margin, x1 - y0 + (int)shape.width + margin};
+        return {y0 - (int)shape.height - 1 - margin, y1 + 2 + margin};
+    }
+
+    // Run a collision until it settles. The target is in the middle of the
+    // board and the projectile collision_distance cells before it.
+    ShotOutcome fire(Lab& lab, const Target& target, const Shape& shape, const Shot& shot,
+                     search::Collision& collision, std::string& key) {
+        const int x0((collision_board_size - target.width) / 2);
+        const int y0((collision_board_size - target.height) / 2);
+        const int x1(x0 + target.width - 1);
+        const int y1(y0 + target.height - 1);
+        const int distance(collision_distance);
+        int x, y, steps;
+        if (shape.dy != 0) {
+            // Both coordinates before the target, then until the whole glider is past it
+            y = std::min(x0 - distance - (int)shape.width - shot.lane,
+                         y0 - distance - (int)shape.height);
+            x = y + shot.lane;
+            steps = (x1 + y1 + distance - x - y) / 2 + 1;
+        } else {
+            x = x0 - distance - (int)shape.width - (int)shot.shift;
+            y = shot.lane;
+            steps = (x1 + distance - x) / 2 + 1;
+        }
+        load(lab, target.phases[shot.phase], x0, y0);
+        for (auto& cell : shape.cells) {
+            lab.board.set(x + cell.x, y + cell.y);
+        }
+        collision.cells = lab.board.live_cells();
+
+        // Once the projectile is past the target, a miss leaves both as they would be alone
+        const unsigned long generations(4 * steps);
+        for (unsigned long generation(0); generation < generations; ++generation) {
+            lab.board.step();
+            if (lab.board.near_edge(settle_edge_margin) && !remove_escapees(lab))
+                return SHOT_UNSETTLED;
+        }
+        std::vector<Coordinates> alone(target.phases[(shot.phase + generations) % target.phases.size()]);
+        for (auto& cell : alone) {
+            cell = {cell.x + x0, cell.y + y0};
+        }
+        for (auto& cell : shape.cells) {
+            alone.push_back({x + steps * shape.dx + cell.x, y + steps * shape.dy + cell.y});
+        }
+        std::sort(alone.begin(), alone.end(), row_order);
+        const std::vector<Coordinates> cells(lab.board.live_cells());
+        if (lab.escaped.empty() && cells.size() == alone.size()
+            && std::equal(cells.begin(), cells.end(), alone.begin(),
+                          [](const Coordinates& a, const Coordinates& b) {
+                return a.x == b.x && a.y == b.y;
+            }))
+            return SHOT_MISSED;
+
+        const Outcome outcome(settle(lab, settle_generations_max));
+        if (!outcome.settled)
+            return SHOT_UNSETTLED;
+        remove_spaceships(lab);
+        identify_objects(lab);
+        collision.emitted = lab.escaped;
+        collision.objects.assign(lab.codes.begin() + lab.escaped.size(), lab.codes.end());
+        std::sort(collision.emitted.begin(), collision.emitted.end());
+        std::sort(collision.objects.begin(), collision.objects.end());
+        collision.lifespan = generations + outcome.lifespan;
+        collision.count = 1;
+        if (!collision.emitted.empty())
+            collision.result = search::EMISSION;
+        else
+            collision.result = collision.objects.size() <= 1 ? search::CLEAN : search::DEBRIS;
+
+        // The same objects in any phase and orientation give the same key
+        uint64_t best(library::canonical_hash(lab.board.live_cells()));
+        const uint64_t first(lab.board.hash());
+        for (unsigned generation(0); generation < settle_window; ++generation) {
+            lab.board.step();
+            if (lab.board.hash() == first)
+                break;
+            best = std::min(best, library::canonical_hash(lab.board.live_cells()));
+        }
+        key = std::to_string(best);
+        for (auto& code : collision.emitted) {
+            key += " " + code;
+        }
+        return SHOT_SETTLED;
+    }
+
+    bool row_order(const Coordinates& a, const Coordinates& b) {
+        return a.y < b.y || (a.y == b.y && a.x < b.x);
+    }
+
+    // @return The names of the objects, or their apgcode if they have none.
+    std::string describe(const std::vector<std::string>& codes) {
+        if (codes.empty())
+            return "nothing";
+        std::string text;
+        for (auto& code : codes) {
+            const std::string name(census::object_name(code));
+            text += (text.empty() ? "" : ", ") + (name.empty() ? code : name);
+        }
+        return text;
+    }
+
+    // A random box a quarter of the time and while the pool is empty, else
+    // a candidate of the pool with one to three cells flipped
+    std::vector<Coordinates> candidate(const std::vector<search::Methuselah>& pool, uint64_t seed,
+                                       unsigned long index, unsigned box_size) {
+        uint64_t state(mix(seed) ^ mix(index));
+        auto draw = [&state]() {
+            return mix(state += 0x9e3779b97f4a7c15);
+        };
+        std::vector<char> box(box_size * box_size, false);
+        if (pool.empty() || draw() % 4 == 0) {
+            for (auto& cell : box) {
+                cell = draw() & 1;
+            }
+        } else {
+            for (auto& cell : pool[draw() % pool.size()].cells) {
+                box[cell.y * box_size + cell.x] = true;
+            }
+            for (unsigned flips(1 + draw() % 3); flips > 0; --flips) {
+                const size_t i(draw() % box.size());
+                box[i] = !box[i];
+            }
+        }
+        std::vector<Coordinates> cells;
+        for (unsigned i(0); i < box.size(); ++i) {
+            if (box[i])
+                cells.push_back({i % box_size, i / box_size});
+        }
+        return cells;
+    }
+
+    // @return false if the candidate does not settle on the board.
+    bool evaluate(Lab& lab, search::Methuselah& methuselah, unsigned box_size) {
+        const unsigned offset((hunt_board_size - box_size) / 2);
+        load(lab, methuselah.cells, offset, offset);
+        const Outcome outcome(settle(lab, settle_generations_max));
+        methuselah.lifespan = outcome.lifespan;
+        methuselah.population = lab.board.population();
+        return outcome.settled;
+    }
+
+    bool better(const search::Methuselah& a, const search::Methuselah& b, search::HuntGoal goal) {
+        if (goal == search::POPULATION && a.population != b.population)
+            return a.population > b.population;
+        if (a.lifespan != b.lifespan)
+            return a.lifespan > b.lifespan;
+        return a.population > b.population;
+    }
+
+    std::string describe(const search::Methuselah& methuselah) {
+        return "# " + std::to_string(methuselah.lifespan) + " generations, "
+               + std::to_string(methuselah.population) + " cells left\n"
+               + simulation::encode_rle(methuselah.cells);
+    }
+
+    // The cells that leave the board die, so a run only explodes if it reaches
+    // the edge with many more cells than it started with
+    search::RuleClass run_rule(Lab& lab, const std::vector<Coordinates>& start, const Rule& rule) {
+        unsigned width(0), height(0);
+        for (auto& cell : start) {
+            width = std::max(width, cell.x + 1);
+            height = std::max(height, cell.y + 1);
+        }
+        load(lab, start, (sweep_board_size - width) / 2, (sweep_board_size - height) / 2);
+        lab.board.set_rule(rule);
+        lab.populations.clear();
+        lab.populations.push_back(lab.board.population());
+        const unsigned explosion(sweep_growth * std::max(lab.board.population(), 1u));
+        for (unsigned long generation(1); generation <= sweep_generations_max; ++generation) {
+            lab.board.step();
+            const unsigned population(lab.board.population());
+            if (population == 0)
+                return search::DIES;
+            if (population >= explosion && lab.board.near_edge(settle_edge_margin))
+                return search::EXPLODES;
+            lab.populations.push_back(population);
+            if (generation % settle_check_interval != 0)
+                continue;
+            const unsigned period(population_period(lab.populations, settle_window));
+            if (period == 0)
+                continue;
+            // A blinker keeps the population constant, the board tells it
+            // unless spaceships move away
+            const uint64_t hash(lab.board.hash());
+            for (unsigned board_period(1); board_period <= settle_period_max; ++board_period) {
+                lab.board.step();
+                if (lab.board.hash() == hash)
+                    return board_period == 1 ? search::STABILIZES : search::OSCILLATES;
+            }
+            return period == 1 ? search::STABILIZES : search::OSCILLATES;
+        }
+        return lab.populations.back() >= explosion ? search::EXPLODES : search::CHAOTIC;
+    }
+
+    Enumerator::Enumerator(unsigned width, unsigned height, unsigned period)
+    :   width(width),
+        height(height),
+        period(period),
+        mask((1ull << (width + 2)) - 1),
+        rows(height * period, 0),
+        n_nodes(0) {}
+
+    void enumerate_period(unsigned width, unsigned height, unsigned period, unsigned n_threads,
+                          std::map<std::string, std::vector<Coordinates>>& found,
+                          unsigned long& n_nodes) {
+        const unsigned n_decisions(height * period);
+        const unsigned split(std::min(enumerate_split_rows, height) * period);
+        std::vector<std::deque<Task>> queues(n_threads);
+        std::vector<std::mutex> locks(n_threads);
+        // Tasks queued or being searched, a search may queue new ones
+        std::atomic<unsigned long> pending(1);
+        queues[0].push_back({std::vector<uint64_t>(n_decisions, 0), 0});
+        std::vector<Enumerator> enumerators(n_threads, Enumerator(width, height, period));
+
+        std::vector<std::thread> workers;
+        for (unsigned t(0); t < n_threads; ++t) {
+            workers.emplace_back([&, t]() {
+                Enumerator& enumerator(enumerators[t]);
+                Task task;
+                while (pending > 0) {
+                    if (!take_task(queues, locks, t, task)) {
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    enumerator.rows = task.rows;
+                    if (task.decision >= split) {
+                        descend(enumerator, task.decision);
+                        --pending;
+                        continue;
+                    }
+                    for (auto row : extensions(enumerator, task.decision)) {
+                        enumerator.rows[task.decision] = row;
+                        if (!consistent(enumerator, task.decision))
+                            continue;
+                        ++enumerator.n_nodes;
+                        if (task.decision + 1 == n_decisions) {
+                            keep(enumerator);
+                        } else {
+                            ++pending;
+                            std::lock_guard<std::mutex> lock(locks[t]);
+                            queues[t].push_back({enumerator.rows, task.decision + 1});
+                        }
+                    }
+                    --pending;
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        for (auto& enumerator : enumerators) {
+            found.insert(enumerator.found.begin(), enumerator.found.end());
+            n_nodes += enumerator.n_nodes;
+        }
+    }
+
+    // Take the last task of the own queue, or steal the first one of another,
+    // the largest subtree it has
+    bool take_task(std::vector<std::deque<Task>>& queues, std::vector<std::mutex>& locks,
+                   unsigned t, Task& task) {
+        for (unsigned i(0); i < queues.size(); ++i) {
+            const unsigned victim((t + i) % queues.size());
+            std::lock_guard<std::mutex> lock(locks[victim]);
+            if (queues[victim].empty())
+                continue;
+            if (i == 0) {
+                task = std::move(queues[victim].back());
+                queues[victim].pop_back();
+            } else {
+                task = std::move(queues[victim].front());
+                queues[victim].pop_front();
+            }
+            return true;
+        }
+        return false;
+    }
+
+    // @return The rows that can be chosen by a decision: the row above comes to
+    // its next phase with them, the cells beside the box staying dead. Above
+    // the box, the dead row must stay dead.
+    const std::vector<uint64_t>& extensions(Enumerator& enumerator, unsigned decision) {
+        const unsigned period(enumerator.period);
+        const unsigned r(decision / period);
+        const unsigned t(decision % period);
+        const std::vector<uint64_t>& rows(enumerator.rows);
+        const uint64_t up(r >= 2 ? rows[(r - 2) * period + t] : 0);
+        const uint64_t row(r >= 1 ? rows[(r - 1) * period + t] : 0);
+        const uint64_t next(r >= 1 ? rows[(r - 1) * period + (t + 1) % period] : 0);
+        const unsigned shift(enumerator.width + 2);
+        const uint64_t key(up | row << shift | next << 2 * shift);
+        auto it(enumerator.extensions.find(key));
+        if (it != enumerator.extensions.end())
+            return it->second;
+
+        std::vector<uint64_t> below;
+        for (uint64_t cells(0); cells < (1ull << enumerator.width); ++cells) {
+            if ((next_row(up, row, cells << 1) & enumerator.mask) == next)
+                below.push_back(cells << 1);
+        }
+        return enumerator.extensions.emplace(key, below).first->second;
+    }
+
+    // Check what the extensions do not: the first row is not empty in every
+    // phase, and once the last row is chosen, it comes to its next phase and
+    // the cells below it stay dead, and the pattern touches the left side of
+    // the box. Each pattern is so found in one position only.
+    bool consistent(const Enumerator& enumerator, unsigned decision) {
+        const unsigned period(enumerator.period);
+        const unsigned r(decision / period);
+        const unsigned t(decision % period);
+        const std::vector<uint64_t>& rows(enumerator.rows);
+        const uint64_t mask(enumerator.mask);
+        if (r == 0 && t == period - 1) {
+            uint64_t any(0);
+            for (unsigned phase(0); phase < period; ++phase) {
+                any |= rows[phase];
+            }
+            if (any == 0)
+                return false;
+        }
+        if (r + 1 < enumerator.height || t + 1 < period)
+            return true;
+
+        for (unsigned phase(0); phase < period; ++phase) {
+            const uint64_t up(r >= 1 ? rows[(r - 1) * period + phase] : 0);
+            const uint64_t last(rows[r * period + phase]);
+            if ((next_row(up, last, 0) & mask) != rows[r * period + (phase + 1) % period]
+                || (next_row(last, 0, 0) & mask))
+                return false;
+        }
+        uint64_t left(0);
+        for (auto row : rows) {
+            left |= row;
+        }
+        return left & 2;
+    }
+
+    void descend(Enumerator& enumerator, unsigned decision) {
+        const bool last(decision + 1 == enumerator.rows.size());
+        for (auto row : extensions(enumerator, decision)) {
+            enumerator.rows[decision] = row;
+            if (!consistent(enumerator, decision))
+                continue;
+            ++enumerator.n_nodes;
+            if (last)
+                keep(enumerator);
+            else
+                descend(enumerator, decision + 1);
+        }
+    }
+
+    // Keep a strict still life, or an oscillator of the exact period made of
+    // a single object, in its canonical phase and orientation
+    void keep(Enumerator& enumerator) {
+        const unsigned period(enumerator.period);
+        const std::vector<uint64_t>& rows(enumerator.rows);
+        for (unsigned divisor(1); divisor < period; ++divisor) {
+            if (period % divisor != 0)
+                continue;
+            bool repeats(true);
+            for (unsigned i(0); i < rows.size() && repeats; ++i) {
+                repeats = rows[i] == rows[i - i % period + (i % period + divisor) % period];
+            }
+            if (repeats)
+                return;
+        }
+
+        std::string best_key;
+        std::vector<Coordinates> best_cells;
+        for (unsigned phase(0); phase < period; ++phase) {
+            std::vector<Coordinates> cells;
+            for (unsigned r(0); r < enumerator.height; ++r) {
+                for (unsigned x(0); x < enumerator.width; ++x) {
+                    if (rows[r * period + phase] >> (x + 1) & 1)
+                        cells.push_back({x, r});
+                }
+            }
+            if (phase == 0 && (period == 1 ? !strict_still_life(enumerator)
+                                           : census::split(cells).size() != 1))
+                return;
+            for (unsigned orientation(0); orientation < 8; ++orientation) {
+                std::vector<Coordinates> oriented(orient(cells, orientation));
+                const std::string key(cells_key(oriented));
+                if (best_key.empty() || key < best_key) {
+                    best_key = key;
+                    best_cells = oriented;
+                }
+            }
+        }
+        enumerator.found.emplace(best_key, best_cells);
+    }
+
+    // @return false if the islands of the still life (its groups of touching
+    // cells) can be split in two groups that are still lifes on their own, or
+    // if there are more than enumerate_islands_max islands.
+    bool strict_still_life(const Enumerator& enumerator) {
+        const unsigned height(enumerator.height);
+        std::vector<uint64_t> left(enumerator.rows);
+        std::vector<std::vector<uint64_t>> islands;
+        for (unsigned r(0); r < height; ++r) {
+            while (left[r] != 0) {
+                std::vector<uint64_t> island(height, 0);
+                island[r] = left[r] & (~left[r] + 1);
+                for (bool grown(true); grown;) {
+                    grown = false;
+                    for (unsigned y(0); y < height; ++y) {
+                        uint64_t around(0);
+                        for (unsigned n(y > 0 ? y - 1 : 0); n <= y + 1 && n < height; ++n) {
+                            around |= island[n] | island[n] << 1 | island[n] >> 1;
+                        }
+                        around &= left[y];
+                        if (around & ~island[y]) {
+                            island[y] |= around;
+                            grown = true;
+                        }
+                    }
+                }
+                for (unsigned y(0); y < height; ++y) {
+                    left[y] &= ~island[y];
+                }
+                islands.push_back(island);
+            }
+        }
+        if (islands.size() > enumerate_islands_max)
+            return false;
+
+        // The first island is always in the first group
+        std::vector<uint64_t> first(height), second(height);
+        for (uint64_t group(1); group + 1 < (1ull << islands.size()); group += 2) {
+            for (unsigned y(0); y < height; ++y) {
+                first[y] = second[y] = 0;
+                for (unsigned i(0); i < islands.size(); ++i) {
+                    (group >> i & 1 ? first[y] : second[y]) |= islands[i][y];
+                }
+            }
+            if (stable(enumerator, first) && stable(enumerator, second))
+                return false;
+        }
+        return true;
+    }
+
+    // @return Whether the rows, with dead cells around the box, are a still life.
+    bool stable(const Enumerator& enumerator, const std::vector<uint64_t>& rows) {
+        const unsigned height(enumerator.height);
+        for (unsigned y(0); y <= height + 1; ++y) {
+            const uint64_t up(y >= 2 ? rows[y - 2] : 0);
+            const uint64_t row(y >= 1 && y <= height ? rows[y - 1] : 0);
+            const uint64_t down(y < height ? rows[y] : 0);
+            if ((next_row(up, row, down) & enumerator.mask) != row)
+                return false;
+        }
+        return true;
+    }
+
+    // @return The cells turned in one of the 8 orientations, moved to the
+    // origin, row by row.
+    std::vector<Coordinates> orient(const std::vector<Coordinates>& cells, unsigned orientation) {
+        std::vector<Coordinates> oriented;
+        unsigned x_max(0), y_max(0);
+        for (auto& cell : cells) {
+            x_max = std::max(x_max, cell.x);
+            y_max = std::max(y_max, cell.y);
+        }
+        const bool transpose(orientation & 4);
+        unsigned u_min(UINT_MAX), v_min(UINT_MAX);
+        for (auto& cell : cells) {
+            unsigned u(cell.x), v(cell.y);
+            if (orientation & 1)
+                u = x_max - u;
+            if (orientation & 2)
+                v = y_max - v;
+            if (transpose)
+                std::swap(u, v);
+            oriented.push_back({u, v});
+            u_min = std::min(u_min, u);
+            v_min = std::min(v_min, v);
+        }
+        for (auto& cell : oriented) {
+            cell = {cell.x - u_min, cell.y - v_min};
+        }
+        std::sort(oriented.begin(), oriented.end(), row_order);
+        return oriented;
+    }
+
+    size_t RowPairHash::operator()(const std::pair<uint64_t, uint64_t>& rows) const {
+        return mix(rows.first ^ mix(rows.second));
+    }
+
+    ParentSearch::ParentSearch(const std::vector<Coordinates>& target, unsigned margin,
+                               search::Progress& progress, std::atomic<bool>& found)
+    :   n_dead_ends(0),
+        n_nodes(0),
+        first(0),
+        reported(0),
+        progress(progress),
+        found(found),
+        halted(false) {
+        unsigned x_min(UINT_MAX), x_max(0), y_min(UINT_MAX), y_max(0);
+        for (auto& cell : target) {
+            x_min = std::min(x_min, cell.x);
+            x_max = std::max(x_max, cell.x);
+            y_min = std::min(y_min, cell.y);
+            y_max = std::max(y_max, cell.y);
+        }
+        transposed = x_max - x_min > y_max - y_min;
+        width = (transposed ? y_max - y_min : x_max - x_min) + 1 + 2 * margin;
+        height = (transposed ? x_max - x_min : y_max - y_min) + 1 + 2 * margin;
+        this->target.assign(height, 0);
+        for (auto& cell : target) {
+            const unsigned x(cell.x - x_min + margin), y(cell.y - y_min + margin);
+            if (transposed)
+                this->target[x] |= 2ull << y;
+            else
+                this->target[y] |= 2ull << x;
+        }
+        rows.assign(height, 0);
+        for (unsigned cells(0); cells < 512; ++cells) {
+            next_cell[cells] = next_row(cells & 7, cells >> 3 & 7, cells >> 6) >> 1 & 1;
+        }
+        dead_ends.resize(height);
+    }
+
+    // Choose the cells of the parent from cell x of row y on, x being the width
+    // once row y is complete
+    // @return Whether a parent is found, false if there is none or the search stopped
+    bool choose(ParentSearch& parent, unsigned y, unsigned x) {
+        if (x == parent.width) {
+            if (y + 1 == parent.height)
+                return true;
+            if (y == 0)
+                return choose(parent, 1, 0);
+            const std::pair<uint64_t, uint64_t> key(parent.rows[y - 1], parent.rows[y]);
+            if (parent.dead_ends[y].count(key) != 0)
+                return false;
+            if (choose(parent, y + 1, 0))
+                return true;
+            if (parent.halted)
+                return false;
+            if (parent.n_dead_ends >= predecessor_dead_ends_max) {
+                for (auto& dead_ends : parent.dead_ends) {
+                    dead_ends.clear();
+                }
+                parent.n_dead_ends = 0;
+            }
+            parent.dead_ends[y].insert(key);
+            ++parent.n_dead_ends;
+            return false;
+        }
+
+        if ((++parent.n_nodes & 0xfff) == 0) {
+            if (stopped(parent))
+                return false;
+            // Cell c is 1 while its second choice is searched
+            unsigned long progress(0);
+            for (unsigned i(0); i < predecessor_progress_cells; ++i) {
+                const unsigned c(parent.first + i);
+                progress <<= 1;
+                if (c < parent.width * parent.height)
+                    progress |= parent.rows[c / parent.width] >> (c % parent.width + 1) & 1;
+            }
+            report(parent, progress);
+        }
+        uint64_t& row(parent.rows[y]);
+        for (uint64_t alive(0); alive < 2 && !parent.halted; ++alive) {
+            row = (row & ~(2ull << x)) | alive << (x + 1);
+            if (fits(parent, y, x) && choose(parent, y, x + 1))
+                return true;
+        }
+        row &= ~(2ull << x);
+        return false;
+    }
+
+    // @return Whether the cell of the next generation whose last neighbour is
+    // cell x of row y of the parent is the one wanted, if that neighbour completes one.
+    bool fits(const ParentSearch& parent, unsigned y, unsigned x) {
+        if (x < 2 || y < 2)
+            return true;
+        // Columns x - 2 to x are bits x - 1 to x + 1
+        const unsigned cells((parent.rows[y - 2] >> (x - 1) & 7)
+                             | (parent.rows[y - 1] >> (x - 1) & 7) << 3
+                             | (parent.rows[y] >> (x - 1) & 7) << 6);
+        return parent.next_cell[cells] == (parent.target[y - 1] >> x & 1);
+    }
+
+    bool stopped(ParentSearch& parent) {
+        parent.halted = parent.halted || parent.progress.cancel || parent.found;
+        return parent.halted;
+    }
+
+    // Add what the current task did since the last report to the progress
+    void report(ParentSearch& parent, unsigned long progress) {
+        if (progress > parent.reported) {
+            parent.progress.done += progress - parent.reported;
+            parent.reported = progress;
+        }
+    }
+
+    // @return The cells in a byte each, for patterns smaller than 256 cells square.
+    std::string cells_key(const std::vector<Coordinates>& cells) {
+        std::string key;
+        key.reserve(2 * cells.size());
+        for (auto& cell : cells) {
+            key += (char)cell.x;
+            key += (char)cell.y;
+        }
+        return key;
+    }
+} /* unnamed namespace */
@@ -0,0 +1,362 @@
+/*
+ * search.h
+ * This module runs the searches that evolve many small patterns on their
+ * own, each one on a board of a worker thread, until they settle. The
+ * first one is a census of random soups: the objects left by each soup
+ * are counted and the rare ones are reported with the soup they come
+ * from, so that it can be reproduced. The second one fires a spaceship at
+ * a target from every lane and timing and sorts the distinct results. The
+ * third one hunts methuselahs by mutating the longest-lived seeds found.
+ * The fourth one runs the same starts under the rules around a B/S rule.
+ * The fifth one enumerates the still lifes and oscillators of a box. The
+ * last one looks for a parent of a pattern, or shows that it has none.
+ *
+ * This file is part of GoL Lab, a simulator of Conway's game of life.
+ *
+ * Copyright (C) 2022-2023 Cyprien Lacassagne
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "board.h"
+#include "census.h"
+#include "config.h"
+
+// Side of the random soups
+constexpr unsigned soup_size(16);
+// Side of the board a soup evolves in
+constexpr unsigned soup_board_size(512);
+// Soups given to a worker at once
+constexpr unsigned soup_batch(64);
+// Longest period of the population taken for a settled pattern
+constexpr unsigned settle_period_max(60);
+// Generations the population must repeat for before the objects are checked
+constexpr unsigned settle_window(3 * settle_period_max);
+// Generations between two checks of the population
+constexpr unsigned settle_check_interval(16);
+// Spaceships closer than this to the edge of the board are taken off it
+constexpr unsigned settle_edge_margin(4);
+// Patterns still evolving after this many generations are given up
+constexpr unsigned long settle_generations_max(50000);
+// Still lifes with at least this many cells are rare finds
+constexpr unsigned rare_population_min(20);
+// Side of the board a collision evolves in
+constexpr unsigned collision_board_size(512);
+// Largest side of a collision target
+constexpr unsigned collision_target_size_max(collision_board_size / 4);
+// Cells between the target and the projectile when it is placed
+constexpr unsigned collision_distance(8);
+// Lanes tried on each side beyond those where the projectile grazes the target
+constexpr unsigned collision_lane_margin(3);
+// Side of the board a methuselah candidate evolves in
+constexpr unsigned hunt_board_size(1024);
+// Default side of the box the methuselah candidates are drawn in
+constexpr unsigned hunt_box_size(6);
+// Candidates evaluated between two updates of the pool
+constexpr unsigned hunt_batch(256);
+// Best candidates the next ones are mutated from
+constexpr unsigned hunt_pool_size(16);
+// Side of the board a rule sweep run evolves in
+constexpr unsigned sweep_board_size(256);
+// Rule sweep runs still evolving after this many generations are chaotic
+constexpr unsigned long sweep_generations_max(4000);
+// Runs reaching the edge with this many times their initial population explode
+constexpr unsigned sweep_growth(4);
+// Rows of the sweep grid: no birth count toggled, then B1 to B8
+constexpr unsigned sweep_rows(9);
+// Columns of the sweep grid: no survival count toggled, then S0 to S8
+constexpr unsigned sweep_columns(10);
+// Largest side of the box of the enumeration
+constexpr unsigned enumerate_size_max(16);
+// Longest period of the enumerated oscillators
+constexpr unsigned enumerate_period_max(4);
+// Rows whose choices are handed out as tasks, the rows below are searched at once
+constexpr unsigned enumerate_split_rows(2);
+// Still lifes with more islands than this are not checked for strictness and left out
+constexpr unsigned enumerate_islands_max(16);
+// Widest parent searched for, the margins on both sides included
+constexpr unsigned predecessor_width_max(62);
+// Largest margin the parent may spread over around the target
+constexpr unsigned predecessor_margin_max(4);
+// Cells of the parent chosen in turn to split the search into tasks
+constexpr unsigned predecessor_split_cells(12);
+// Cells chosen after the split whose choices tell how far a task is
+constexpr unsigned predecessor_progress_cells(16);
+// Pairs of rows leading nowhere a thread remembers before forgetting them all
+constexpr unsigned long predecessor_dead_ends_max(1ul << 22);
+
+namespace search {
+    // Shared between a long search and the thread that watches it
+    struct Progress {
+        Progress();
+
+        // Work done out of total, total is set once the search is split
+        std::atomic<unsigned long> done;
+        std::atomic<unsigned long> total;
+        // Set to stop the search as soon as possible
+        std::atomic<bool> cancel;
+    };
+
+    struct Find {
+        std::string apgcode;
+        // Index of the soup the object comes from
+        unsigned long soup;
+    };
+
+    struct Haul {
+        uint64_t seed;
+        unsigned long n_soups;
+        // Objects left by the soups, sorted by decreasing count
+        std::vector<census::Object> objects;
+        // Rare objects, and soups that did not settle ("unsettled") or that sent
+        // something other than a spaceship out of the board ("overflow")
+        std::vector<Find> finds;
+        double seconds;
+    };
+
+    /**
+     * Evolve random soups until they settle and count the objects they leave.
+     * The same seed always gives the same soups, whatever the number of threads.
+     * @param seed Seed of the first soup, soup i is drawn from seed and i.
+     * @param n_soups Number of soups.
+     * @param n_threads Number of worker threads, each one with its own board.
+     */
+    Haul soups(uint64_t seed, unsigned long n_soups, unsigned n_threads);
+
+    /**
+     * @return The live cells of soup index of the seed, in a soup_size square.
+     */
+    std::vector<Coordinates> soup(uint64_t seed, unsigned long index);
+
+    /**
+     * @return Whether an object deserves to be reported: a still life of at
+     * least rare_population_min cells, an oscillator of period 3 or more, a
+     * spaceship other than the glider, or an object that could not be classified.
+     */
+    bool is_rare(const std::string& apgcode);
+
+    /**
+     * @return The census of the haul and its rare finds, with the RLE of their soup.
+     */
+    std::string format_haul(const Haul& haul);
+
+    // The glider comes from the top left, the *WSS from the left
+    enum Projectile { GLIDER, LWSS, MWSS, HWSS };
+
+    // CLEAN: at most one object is left, DEBRIS: several objects are left,
+    // EMISSION: spaceships fly away
+    enum CollisionResult { CLEAN, DEBRIS, EMISSION };
+
+    struct Collision {
+        // Target and projectile as placed
+        std::vector<Coordinates> cells;
+        CollisionResult result;
+        // apgcodes of the objects left, sorted
+        std::vector<std::string> objects;
+        // apgcodes of the spaceships flying away, sorted
+        std::vector<std::string> emitted;
+        // Generations before the result settles
+        unsigned long lifespan;
+        // Collisions giving the same result, up to the orientation
+        unsigned count;
+    };
+
+    struct CollisionSearch {
+        Projectile projectile;
+        // 0 if the target is not a still life or an oscillator that fits on the board
+        unsigned target_period;
+        unsigned long n_tried;
+        // Collisions where the projectile passes by without touching the target
+        unsigned long n_misses;
+        unsigned long n_unsettled;
+        // Distinct results, clean ones first
+        std::vector<Collision> collisions;
+        double seconds;
+    };
+
+    /**
+     * Fire a projectile at every orientation of a target, on every lane where
+     * it may touch the target and at every phase of the target, and run the
+     * collisions until they settle.
+     * @param target Live cells of a still life or an oscillator.
+     * @param n_threads Number of worker threads, each one with its own board.
+     * @param progress Counts the collisions run, the search stops once cancel is set.
+     */
+    CollisionSearch collide(const std::vector<Coordinates>& target, Projectile projectile,
+                            unsigned n_threads, Progress& progress);
+
+    /**
+     * @return The distinct results of the search, each one with the RLE of a
+     * collision giving it.
+     */
+    std::string format_collisions(const CollisionSearch& search);
+
+    // What makes a methuselah candidate better than another
+    enum HuntGoal { LIFESPAN, POPULATION };
+
+    struct Methuselah {
+        std::vector<Coordinates> cells;
+        // Generations before the population becomes periodic
+        unsigned long lifespan;
+        // Cells left once settled, spaceships flown away excluded
+        unsigned population;
+    };
+
+    struct Hunt {
+        uint64_t seed;
+        unsigned long n_candidates;
+        unsigned box_size;
+        HuntGoal goal;
+        // Candidates that did not settle or sent debris out of the board
+        unsigned long n_unsettled;
+        // Best candidates first
+        std::vector<Methuselah> best;
+        double seconds;
+    };
+
+    /**
+     * Look for small patterns that live long or leave many cells. Candidates
+     * are drawn at random in a box or mutated from the best ones so far, and
+     * evaluated hunt_batch at a time on worker threads.
+     * @param box_size Side of the box the candidates are drawn in.
+     * @param records Each candidate entering the hunt_pool_size best ones is
+     * written to it as soon as its batch is done.
+     */
+    Hunt hunt(uint64_t seed, unsigned long n_candidates, unsigned box_size, HuntGoal goal,
+              unsigned n_threads, std::ostream& records);
+
+    /**
+     * @return The best candidates of the hunt, with their RLE.
+     */
+    std::string format_hunt(const Hunt& hunt);
+
+    enum RuleClass { DIES, STABILIZES, OSCILLATES, EXPLODES, CHAOTIC, N_RULE_CLASSES };
+
+    struct RuleRuns {
+        Rule rule;
+        // Number of starts in each class
+        std::array<unsigned long, N_RULE_CLASSES> counts;
+    };
+
+    struct RuleSweep {
+        Rule base;
+        unsigned long n_starts;
+        // Row by row, sweep_rows x sweep_columns
+        std::vector<RuleRuns> runs;
+        double seconds;
+    };
+
+    /**
+     * Run each start under the base rule and the rules it gives with one birth
+     * count and/or one survival count toggled, and classify the runs by their
+     * population: it dies, becomes constant or periodic, grows to the edge of
+     * the board or is still aperiodic after sweep_generations_max.
+     * @param starts Patterns fitting in half the board.
+     * @param n_threads Number of worker threads, each one with its own board.
+     */
+    RuleSweep sweep_rules(const std::vector<std::vector<Coordinates>>& starts, const Rule& base,
+                          unsigned n_threads);
+
+    /**
+     * @return The grid of the most frequent class of each rule, followed by
+     * the counts of all the classes.
+     */
+    std::string format_sweep(const RuleSweep& sweep);
+
+    struct Enumerated {
+        std::string apgcode;
+        // The phase and orientation with the smallest description, at the origin
+        std::vector<Coordinates> cells;
+    };
+
+    struct Enumeration {
+        unsigned width;
+        unsigned height;
+        unsigned period;
+        // Sorted by apgcode
+        std::vector<Enumerated> patterns;
+        // Partial patterns the backtracking went through
+        unsigned long n_nodes;
+        double seconds;
+    };
+
+    /**
+     * List the strict still lifes (period 1), or the oscillators of period 2 to
+     * period made of a single object, that fit in a width x height box. The search
+     * backtracks row by row (every phase of a row, then the next row) and
+     * threads steal the subtrees of the first rows from each other.
+     * @param width At most enumerate_size_max, like height.
+     * @param period At most enumerate_period_max.
+     */
+    Enumeration enumerate(unsigned width, unsigned height, unsigned period, unsigned n_threads);
+
+    /**
+     * Write each pattern of the enumeration to directory/<apgcode>.rle.
+     * @return The number of files written.
+     */
+    unsigned save_enumeration(const Enumeration& enumeration, std::string directory);
+
+    /**
+     * @return The list of the patterns of the enumeration.
+     */
+    std::string format_enumeration(const Enumeration& enumeration);
+
+    enum PredecessorResult { PARENT_FOUND, NO_PARENT, SEARCH_CANCELLED };
+
+    struct Predecessor {
+        PredecessorResult result;
+        unsigned margin;
+        // The parent, from margin cells above and to the left of the target
+        std::vector<Coordinates> cells;
+        // Cells of the parent chosen on the way
+        unsigned long n_nodes;
+        double seconds;
+    };
+
+    /**
+     * Look for a parent of the target: a pattern spreading at most margin
+     * cells beyond the bounding box of the target, whose next generation is
+     * the target in its bounding box and dead in the margin - 1 cells around
+     * it. With a margin of 1, finding none proves that the target is an
+     * orphan: every pattern holding it in its bounding box is a Garden of Eden.
+     * The cells of the parent are chosen one at a time, row by row across the
+     * shorter side, and each cell of the next generation is checked as soon as
+     * its neighbours are chosen. The pairs of rows after which no parent can be
+     * completed are remembered. Threads take the choices of the first
+     * predecessor_split_cells cells as tasks, how far a task is being told by
+     * the choices of the next predecessor_progress_cells cells.
+     * @param target Not empty, its shorter side plus twice the margin at most
+     * predecessor_width_max.
+     * @param margin From 1 to predecessor_margin_max.
+     * @param progress The search stops once cancel is set.
+     */
+    Predecessor predecessor(const std::vector<Coordinates>& target, unsigned margin,
+                            unsigned n_threads, Progress& progress);
+
+    /**
+     * @return What the search found, with the RLE of the parent.
+     */
+    std::string format_predecessor(const Predecessor& predecessor);
+} /* namespace search */
+
+#endif
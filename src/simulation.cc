@@ -18,12 +18,21 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <array>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <cstdlib>
+#include <cstdint>
+#include <climits>
+#include <cmath>
 #include <string>
+#include <deque>
+#include <unordered_map>
 #include "simulation.h"
+#include "board.h"
+#include "timeseries.h"
 #include "config.h"
 
 namespace {
@@ -41,31 +50,122 @@ namespace {
         std::string line;
     };
 
-    struct RLEWidthHeight {
-        unsigned width;
-        unsigned height;
+    typedef std::vector<Coordinates> LineBuffer;
+
+    struct HistoryEntry {
+        uint64_t state_hash;
+        uint64_t shape_hash;
+        unsigned x_min;
+        unsigned y_min;
+        // Shape of the cells of the unstable tiles, from the corner of these tiles
+        uint64_t unsettled_hash;
+        unsigned unsettled_x;
+        unsigned unsettled_y;
+        unsigned population;
     };
 
-    typedef std::vector<Coordinates> LineBuffer;
+    // Part of the stability map, tile_size x tile_size cells
+    struct Tile {
+        // Zobrist hash of the live cells of the tile
+        uint64_t hash;
+        // Sum of the shape keys of the live cells of the tile
+        uint64_t shape;
+        // Hash of the tile at the last generations, indexed by generation
+        std::array<uint64_t, tile_period_max + 1> past;
+        unsigned long last_change;
+        // Smallest period the tile showed at the last generation, 0 if none
+        unsigned period;
+        // Generations the tile has kept that period
+        unsigned streak;
+        // Whether a cell of the tile changed during the last generations
+        bool active;
+    };
+
+    // Modulus of the shape hash, the Mersenne prime 2^61 - 1
+    constexpr uint64_t shape_modulus((uint64_t(1) << 61) - 1);
+    constexpr uint64_t shape_base_x(0x1b873593a5f1c9e);
+    constexpr uint64_t shape_base_y(0x0cc9e2d51d2b6e7);
 
     // Decode a line of Life 1.06 files
     ReadingStatus decode_line(std::string line, std::vector<Coordinates>& initial_state);
-    RLEWidthHeight get_rle_width_height(std::string rle_header);
     void decode_rle_body(unsigned width, unsigned height, std::string rle_body,
                          std::vector<Coordinates>& cells);
 
+    // Age of the fading cells, 0 for the others, two cells per byte
+    unsigned fade_age(unsigned x, unsigned y);
+    void set_fade_age(unsigned x, unsigned y, unsigned age);
+    // Start the fading of a cell that just died, or age the fading cells
+    void fade_start(unsigned x, unsigned y);
     void fade_update();
+    void reset_fade();
     unsigned neighbours(unsigned x, unsigned y);
 
+    // Change the state of a cell from within the generation step
+    void birth(unsigned x, unsigned y);
+    void death(unsigned x, unsigned y);
+
+    // Record a change of state to be drawn and shown, or forget them once drawn
+    void note_change(unsigned x, unsigned y);
+    void add_change(std::vector<Coordinates>& list, bool& lost, unsigned x, unsigned y);
+    void forget_changes();
+
+    uint64_t zobrist_key(unsigned x, unsigned y);
+    void rehash_state();
+    void record_state();
+
+    uint64_t add_mod(uint64_t a, uint64_t b);
+    uint64_t mul_mod(uint64_t a, uint64_t b);
+    uint64_t pow_mod(uint64_t base, uint64_t exponent);
+    std::vector<uint64_t> powers(uint64_t base, unsigned n);
+    uint64_t shape_key(unsigned x, unsigned y);
+
+    // Count a change of state of the cell in the heatmap
+    void heat_up(unsigned x, unsigned y);
+
+    // Keep the occupancy counts and the bounding box up to date
+    void occupy(unsigned x, unsigned y);
+    void vacate(unsigned x, unsigned y);
+    void recount();
+    unsigned density_index(unsigned level, unsigned x, unsigned y);
+
+    void touch_tile(unsigned x, unsigned y, uint64_t key, uint64_t shape);
+    void update_tiles();
+    void reset_tiles();
+    unsigned gcd(unsigned a, unsigned b);
+
     void print_selection(unsigned i_min, unsigned i_max, unsigned y_min, unsigned y_max);
 
+    bool in_view(const Coordinates& cell, const simulation::BoundingBox& view);
+    const std::vector<Coordinates>& cells_in_view(simulation::BoundingBox view);
+
     Grid grid(initial_height, std::vector<bool>(initial_width));
     Grid updated_grid(initial_height, std::vector<bool>(initial_width));
 #ifdef LIVE_ARRAY_OPTIMIZATION
     LineBuffer live_cells_buffer;
 #endif
-
-    std::vector<Coordinates> dead, dead2, dead3, dead4;
+    // Live cells in sight gathered by the last drawing, kept for its capacity
+    std::vector<Coordinates> view_cells;
+    // Fading cells in sight and their age, kept for their capacity
+    std::vector<Coordinates> faded_cells;
+    std::vector<uint8_t> faded_ages;
+    // Cells whose state changed since the last drawing, only they are drawn
+    // again while changes_lost is false
+    std::vector<Coordinates> changes;
+    bool changes_lost(true);
+    // The same changes until the GUI asked for their area to be repainted, kept
+    // apart since a partial repaint draws the cells before the GUI saw them
+    std::vector<Coordinates> unshown_changes;
+    bool unshown_changes_lost(true);
+    // Set when the image of the pixel renderer missed some changes
+    bool cells_image_stale(true);
+    // The changes split by the current state of the cells, kept for their capacity
+    std::vector<Coordinates> born_cells, died_cells;
+
+    // Generations since the death of each cell while it fades, cell (x, y) in
+    // the 4 bits at y * world_width + x. Only allocated while the fade effect
+    // is enabled, the cells with a non-zero age are also listed in fading.
+    std::vector<uint8_t> fade_ages;
+    std::vector<Coordinates> fading;
 
     ErrorInfo error = {OK, 0, ""};
 
@@ -76,15 +176,67 @@ namespace {
 
     int dead_count(0);
     int born_count(0);
-    int past_alive(0);
-    int past_2_alive(0);
-    int past_3_alive(0);
-    int past_4_alive(0);
-    int past_5_alive(0);
-    bool stable(false);
-    bool past_stable(false);
+
+    // Zobrist hash of the live set, updated on each birth and death
+    uint64_t state_hash(0);
+    // Sum of x_powers[x]*y_powers[y] over the live set. Translating the set by
+    // (dx, dy) multiplies it by x_powers[dx]*y_powers[dy], so it is brought back
+    // to the bounding box corner in O(1) to compare shapes regardless of position.
+    uint64_t shape_sum(0);
+    const std::vector<uint64_t> x_powers(powers(shape_base_x, world_size_max));
+    const std::vector<uint64_t> y_powers(powers(shape_base_y, world_size_max / 2));
+    const std::vector<uint64_t> x_inverse_powers(powers(pow_mod(shape_base_x, shape_modulus - 2),
+                                                        world_size_max));
+    const std::vector<uint64_t> y_inverse_powers(powers(pow_mod(shape_base_y, shape_modulus - 2),
+                                                        world_size_max / 2));
+    // Number of live cells in each row (by y) and in each column (by x)
+    std::vector<unsigned> row_count(initial_height, 0);
+    std::vector<unsigned> column_count(initial_width, 0);
+    // Live cells of each block of 2^level x 2^level cells at density[level - 1],
+    // block (i, j) at j * ceil(world_width / 2^level) + i
+    std::vector<std::vector<uint16_t>> density(density_levels);
+    // Bounding box of the live cells, x_min > x_max when there are none
+    simulation::BoundingBox bbox({initial_width, 0, initial_height, 0});
+    // Stability map, tile (i, j) covering x in [i, i+1) * tile_size and y in [j, j+1) * tile_size
+    unsigned tiles_x((initial_width + tile_size - 1) / tile_size);
+    std::vector<Tile> tiles(tiles_x * ((initial_height + tile_size - 1) / tile_size), Tile());
+    // Tiles that changed during the last tile_period_max + 1 generations
+    std::vector<unsigned> active_tiles;
+    unsigned unstable_tiles(0);
+    // Sum of the shape keys of the cells of the unstable tiles, and the corner
+    // of these tiles. A pattern moving away from the part it settled, like a
+    // puffer, shows as the same sum from another corner.
+    uint64_t unsettled_sum(0);
+    unsigned unsettled_x(0);
+    unsigned unsettled_y(0);
+    // Bounding box of the cells written into grid by the last generation step
+    simulation::BoundingBox grid_bbox({0, initial_width - 1, 0, initial_height - 1});
+
+    // Bounded history of the last states and the generation they were met at
+    std::deque<HistoryEntry> history;
+    std::unordered_map<uint64_t, unsigned long> hash_generation;
+    std::unordered_map<uint64_t, unsigned long> shape_generation;
+    std::unordered_map<uint64_t, unsigned long> unsettled_generation;
+    // Set whenever the state is edited outside of the generation step
+    bool history_dirty(true);
+    unsigned long generation(0);
+    unsigned period(0);
+    simulation::Displacement displacement({0, 0});
+    // Set when only the unstable tiles repeat and the pattern grew meanwhile
+    bool puffer(false);
+    // Population, births, deaths and bounding box of each generation
+    TimeSeries series;
 
     bool fade_effect_enabled(false);
+    bool pixel_renderer_enabled(true);
+
+    // Number of changes of state of each cell, row y at y*world_width,
+    // saturated at UINT16_MAX. Only allocated while the heatmap is enabled.
+    std::vector<uint16_t> heat;
+    uint16_t heat_max(0);
+    // Changed with heat, the heatmap image is only drawn again when it changed
+    unsigned long heat_version(0);
+    bool heatmap_enabled(false);
 
     unsigned x(0);
     unsigned y(0);
@@ -186,41 +338,118 @@ void simulation::save_file(std::string filename) {
 }
 
 std::vector<Coordinates> simulation::get_rle_data(std::string filename) {
+    // The world only runs B3/S23 patterns
+    std::string rule_text;
+    std::vector<Coordinates> cells(get_rle_data(filename, rule_text));
+    Rule rule;
+    if (!parse_rule(rule_text, rule) || rule.birth != life_rule.birth
+        || rule.survival != life_rule.survival)
+        cells.clear();
+    return cells;
+}
+
+std::vector<Coordinates> simulation::get_rle_data(std::string filename, std::string& rule) {
     std::vector<Coordinates> cells;
-    std::string line;
     std::ifstream file(filename);
-    std::cout << filename << "\n";
-    
-    if (!file.fail()) {
-        std::cout << "OK\n";
-
-        unsigned width(0);
-        unsigned height(0);
-        std::string rle_string, rle_body;
-        std::ostringstream ss;
-        ss << file.rdbuf();
-        rle_string = ss.str();
-
-        if (rle_string.find("b3/s23") != std::string::npos) {
-            const size_t start_pos = rle_string.find("b3/s23");
-            rle_body = rle_string.substr(start_pos+6, rle_string.length());
-        }else if (rle_string.find("B3/S23") != std::string::npos) {
-            const size_t start_pos = rle_string.find("B3/S23");
-            rle_body = rle_string.substr(start_pos+6, rle_string.length());
-        }
-
-        while (getline(file, line)) {
-            if (line[0] == '#')
-                continue;    
-            width = get_rle_width_height(line).width;
-            height = get_rle_width_height(line).height;
-            break;
+    std::string line, rle_body;
+    bool header_read(false);
+    rule = "B3/S23";
+    while (getline(file, line)) {
+        if (!header_read) {
+            if (line.empty() || line[0] == '#')
+                continue;
+            header_read = true;
+            if (line[0] == 'x') {
+                const size_t rule_pos(line.find("rule"));
+                if (rule_pos != std::string::npos) {
+                    // Some files leave out the '=' after "rule"
+                    size_t value_pos(line.find_first_not_of(" \t", rule_pos + 4));
+                    if (value_pos != std::string::npos && line[value_pos] == '=')
+                        ++value_pos;
+                    std::string text(value_pos == std::string::npos ? "" : line.substr(value_pos));
+                    text = text.substr(0, text.find(':'));
+                    text.erase(std::remove_if(text.begin(), text.end(), ::isspace), text.end());
+                    if (!text.empty())
+                        rule = text;
+                }
+                continue;
+            }
         }
-        decode_rle_body(width, height, rle_body, cells);
+        // Anything after the end of the pattern is a comment
+        const size_t end(line.find('!'));
+        rle_body += line.substr(0, end == std::string::npos ? end : end + 1);
+        if (end != std::string::npos)
+            break;
     }
+    decode_rle_body(0, 0, rle_body, cells);
     return cells;
 }
 
+std::string simulation::encode_rle(const std::vector<Coordinates>& cells, std::string rule) {
+    unsigned x_min(UINT_MAX), x_max(0), y_min(UINT_MAX), y_max(0);
+    for (auto& cell : cells) {
+        x_min = std::min(x_min, cell.x);
+        x_max = std::max(x_max, cell.x);
+        y_min = std::min(y_min, cell.y);
+        y_max = std::max(y_max, cell.y);
+    }
+    if (cells.empty())
+        x_min = x_max = y_min = y_max = 0;
+    const unsigned width(x_max - x_min + 1);
+    const unsigned height(y_max - y_min + 1);
+    std::vector<bool> bitmap((size_t)width * height, false);
+    for (auto& cell : cells) {
+        bitmap[(size_t)(cell.y - y_min) * width + cell.x - x_min] = true;
+    }
+
+    // Runs of the same tag, the dead cells at the end of a row are left out
+    std::vector<std::string> runs;
+    unsigned pending_rows(0);
+    auto add_run = [&runs](unsigned count, char tag) {
+        runs.push_back((count > 1 ? std::to_string(count) : "") + tag);
+    };
+    for (unsigned row(0); row < height; ++row) {
+        unsigned col(0);
+        while (col < width) {
+            const bool alive(bitmap[(size_t)row * width + col]);
+            unsigned end(col);
+            while (end < width && bitmap[(size_t)row * width + end] == alive) {
+                ++end;
+            }
+            if (alive || end < width) {
+                if (pending_rows > 0)
+                    add_run(pending_rows, '$');
+                pending_rows = 0;
+                add_run(end - col, alive ? 'o' : 'b');
+            }
+            col = end;
+        }
+        ++pending_rows;
+    }
+    runs.push_back("!");
+
+    std::string rle("x = " + std::to_string(width) + ", y = " + std::to_string(height)
+                    + ", rule = " + rule + "\n");
+    unsigned line_length(0);
+    for (auto& run : runs) {
+        if (line_length + run.size() > 70) {
+            rle += "\n";
+            line_length = 0;
+        }
+        rle += run;
+        line_length += run.size();
+    }
+    return rle + "\n";
+}
+
+std::vector<Coordinates> simulation::get_live_cells() {
+#ifdef LIVE_ARRAY_OPTIMIZATION
+    return live_cells_buffer;
+#else
+    return get_live_cells_in_area(0, world_width - 1, 0, world_height - 1);
+#endif
+}
+
 std::vector<Coordinates> simulation::get_live_cells_in_area(unsigned x_min, unsigned x_max,
                                                 unsigned y_min, unsigned y_max) {
     unsigned i_min(world_height - 1 - y_max);
@@ -241,31 +470,40 @@ std::vector<Coordinates> simulation::get_live_cells_in_area(unsigned x_min, unsi
 }
 
 bool simulation::update(Mode mode) {
-    past_5_alive = past_4_alive;
-    past_4_alive = past_3_alive;
-    past_3_alive = past_2_alive;
-    past_2_alive = past_alive;
-    past_alive = born_count;
     born_count = 0;
     dead_count = 0;
-    past_stable = stable;
-    stable = false;
 
-    // Update vectors for fade effect
-    if (fade_effect_enabled)
-        fade_update();   
+    // The history is meaningless once the state has been edited by hand
+    if (history_dirty) {
+        history.clear();
+        hash_generation.clear();
+        shape_generation.clear();
+        unsettled_generation.clear();
+        history_dirty = false;
+        record_state();
+    }
+
+    if (fade_effect_enabled) {
+        // The ages of the fading cells are part of the image of the pixel renderer
+        if (!fading.empty())
+            cells_image_stale = true;
+        fade_update();
+    }
 
 #ifdef LIVE_ARRAY_OPTIMIZATION
     LineBuffer temp_buffer(live_cells_buffer);
 
-    for (auto& row : grid) {
-        for (unsigned j(0); j < row.size(); ++j) {
-            row[j] = 0;
+    // Only the bounding box of the previous step holds live cells in grid
+    if (grid_bbox.x_min <= grid_bbox.x_max) {
+        for (unsigned y(grid_bbox.y_min); y <= grid_bbox.y_max; ++y) {
+            auto& row(grid[world_height - 1 - y]);
+            std::fill(row.begin() + grid_bbox.x_min, row.begin() + grid_bbox.x_max + 1, false);
         }
     }
     for (auto cell : temp_buffer) {
         grid[world_height - 1 - cell.y][cell.x] = 1;
     }
+    grid_bbox = bbox;
 
     for (auto& cell : temp_buffer) {
         for (int x_offset(-1); x_offset <= 1; ++x_offset) {
@@ -282,19 +520,16 @@ bool simulation::update(Mode mode) {
                     unsigned n(neighbours(x_n, y_n));
                     if (!grid[world_height - 1 - y_n][x_n]) {
                         if (n == 3) {
-                            simulation::set_cell(x_n, y_n);
-                            ++born_count;
-                        }
-                    }else {
-                        if (n == 2 || n == 3) {
-                            simulation::set_cell(x_n, y_n);
-                            --born_count;
-                        }else {
-                            simulation::clear_cell(x_n, y_n);
-                            if (fade_effect_enabled)
-                                dead.push_back({x_n, y_n});
-                            ++dead_count;
+                            birth(x_n, y_n);
+                            if (heatmap_enabled)
+                                heat_up(x_n, y_n);
                         }
+                    }else if (n != 2 && n != 3) {
+                        death(x_n, y_n);
+                        if (fade_effect_enabled)
+                            fade_start(x_n, y_n);
+                        if (heatmap_enabled)
+                            heat_up(x_n, y_n);
                     }
                 }
             }
@@ -315,18 +550,14 @@ bool simulation::update(Mode mode) {
     }
 #endif // LIVE_ARRAY_OPTIMIZATION
 
-    // 5-perdiodic oscillations detection
-    if (mode == EXPERIMENTAL) {
-        if (born_count == past_alive && past_alive == past_2_alive && past_2_alive == past_3_alive)
-            stable = true;
-        if (born_count == past_2_alive && past_alive == past_3_alive && past_2_alive == past_4_alive)
-            stable = true;
-        if (born_count == past_3_alive && past_alive == past_4_alive && past_2_alive == past_5_alive)
-            stable = true;
-        if (stable && past_stable)
-            return true;
-    }
-    return false;
+    ++generation;
+    update_tiles();
+    record_state();
+    series.record(generation, {nb_alive, (unsigned)born_count, (unsigned)dead_count,
+                               nb_alive ? bbox.x_max - bbox.x_min + 1 : 0,
+                               nb_alive ? bbox.y_max - bbox.y_min + 1 : 0});
+
+    return mode == EXPERIMENTAL && (period != 0 || unstable_tiles == 0);
 }
 
 void simulation::init() {
@@ -339,12 +570,23 @@ void simulation::init() {
 #ifdef LIVE_ARRAY_OPTIMIZATION
     live_cells_buffer.clear();
 #endif
-    dead.clear();
-    dead2.clear();
-    dead3.clear();
-    dead4.clear();
+    reset_fade();
 
     nb_alive = 0;
+    recount();
+    state_hash = 0;
+    shape_sum = 0;
+    history_dirty = true;
+    period = 0;
+    displacement = {0, 0};
+    puffer = false;
+    generation = 0;
+    series.clear();
+    clear_heatmap();
+    changes.clear();
+    changes_lost = true;
+    unshown_changes.clear();
+    unshown_changes_lost = true;
 }
 
 bool simulation::is_alive(unsigned x, unsigned y) {
@@ -355,6 +597,63 @@ unsigned simulation::get_population() {
     return nb_alive;
 }
 
+unsigned simulation::get_period() {
+    return period;
+}
+
+simulation::Displacement simulation::get_displacement() {
+    return displacement;
+}
+
+bool simulation::is_puffer() {
+    return puffer;
+}
+
+bool simulation::is_settled() {
+    return unstable_tiles == 0;
+}
+
+void simulation::draw_stability_map() {
+    std::vector<TileState> states(tiles.size(), TILE_SETTLED);
+    for (auto index : active_tiles) {
+        const Tile& tile(tiles[index]);
+        if (tile.period != 0 && tile.streak >= tile_confirmation)
+            states[index] = TILE_OSCILLATING;
+        else
+            states[index] = TILE_ACTIVE;
+    }
+    graphic_draw_stability_map(states, tiles_x);
+}
+
+simulation::BoundingBox simulation::get_bounding_box() {
+    return bbox;
+}
+
+const TimeSeries& simulation::get_time_series() {
+    return series;
+}
+
+std::string simulation::get_speed() {
+    unsigned dx(std::abs(displacement.dx));
+    unsigned dy(std::abs(displacement.dy));
+    if (period == 0 || (dx == 0 && dy == 0))
+        return "";
+
+    unsigned a(dx > dy ? dx : dy);
+    unsigned b(dx > dy ? dy : dx);
+    unsigned p(period);
+    unsigned divisor(gcd(gcd(a, b), p));
+    a /= divisor;
+    b /= divisor;
+    p /= divisor;
+
+    if (b == 0)
+        return (a == 1 ? "" : std::to_string(a)) + "c/" + std::to_string(p) + " orthogonal";
+    if (a == b)
+        return (a == 1 ? "" : std::to_string(a)) + "c/" + std::to_string(p) + " diagonal";
+    return "(" + std::to_string(a) + "," + std::to_string(b) + ")c/" + std::to_string(p) + " oblique";
+}
+
 void simulation::resize_world(unsigned width) {
     grid.resize(width / 2);
     for (auto& col : grid) {
@@ -375,30 +674,27 @@ void simulation::resize_world(unsigned width) {
 #endif
     world_width = width;
     world_height = width / 2;
+    recount();
+    rehash_state();
+    clear_heatmap();
+    reset_fade();
+    changes.clear();
+    changes_lost = true;
+    unshown_changes.clear();
+    unshown_changes_lost = true;
 }
 
 void simulation::set_cell(unsigned x, unsigned y) {
     if (!updated_grid[world_height - 1 - y][x]) {
-        updated_grid[world_height - 1 - y][x] = true;
-#ifdef LIVE_ARRAY_OPTIMIZATION
-        live_cells_buffer.push_back({x, y});
-        nb_alive = live_cells_buffer.size();
-#endif
+        history_dirty = true;
+        birth(x, y);
     }
 }
 
 void simulation::clear_cell(unsigned x, unsigned y) {
     if (updated_grid[world_height - 1 - y][x]) {
-        updated_grid[world_height - 1 - y][x] = false;
-#ifdef LIVE_ARRAY_OPTIMIZATION
-        for (size_t i(0); i < live_cells_buffer.size(); ++i) {
-            if (live_cells_buffer[i].x == x && live_cells_buffer[i].y == y) {
-                live_cells_buffer.erase(live_cells_buffer.begin() + i);
-                break;
-            }
-        }
-        nb_alive = live_cells_buffer.size();
-#endif
+        history_dirty = true;
+        death(x, y);
     }
 }
 
@@ -420,61 +716,137 @@ void simulation::clear_pattern(unsigned x, unsigned y, std::vector<Coordinates>
     }
 }
 
-void simulation::draw_cells(unsigned color_theme) {
+void simulation::draw_cells(unsigned color_theme, BoundingBox view, double pixels_per_cell) {
+    view.x_max = std::min(view.x_max, world_width - 1);
+    view.y_max = std::min(view.y_max, world_height - 1);
 
-    if (fade_effect_enabled) {
-        if (color_theme) {
-            for (unsigned i(0); i < dead4.size(); ++i) {
-                graphic_fade_dead(dead4[i].x, dead4[i].y, gray4);
-            }
-            for (unsigned i(0); i < dead3.size(); ++i) {
-                graphic_fade_dead(dead3[i].x, dead3[i].y, gray3);
-            }
-            for (unsigned i(0); i < dead2.size(); ++i) {
-                graphic_fade_dead(dead2[i].x, dead2[i].y, gray2);
-            }
-            for (unsigned i(0); i < dead.size(); ++i) {
-                graphic_fade_dead(dead[i].x, dead[i].y, gray1);
-            }
-        }else {
-            for (unsigned i(0); i < dead4.size(); ++i) {
-                graphic_fade_dead(dead4[i].x, dead4[i].y, gray1);
-            }
-            for (unsigned i(0); i < dead3.size(); ++i) {
-                graphic_fade_dead(dead3[i].x, dead3[i].y, gray2);
-            }
-            for (unsigned i(0); i < dead2.size(); ++i) {
-                graphic_fade_dead(dead2[i].x, dead2[i].y, gray3);
-            }
-            for (unsigned i(0); i < dead.size(); ++i) {
-                graphic_fade_dead(dead[i].x, dead[i].y, gray4);
-            } 
+    faded_cells.clear();
+    faded_ages.clear();
+    for (auto& cell : fading) {
+        if (in_view(cell, view)) {
+            faded_cells.push_back(cell);
+            faded_ages.push_back(fade_age(cell.x, cell.y));
         }
     }
-#ifdef LIVE_ARRAY_OPTIMIZATION
-    for (auto cell : live_cells_buffer) {
-        graphic_draw_cell(cell.x, cell.y, color_theme);
-    }
-#else
-    for (unsigned i(0); i < updated_grid.size(); ++i) {
-        for (unsigned j(0); j < updated_grid[i].size(); ++j) {
-            if (updated_grid[i][j]) {
-                graphic_draw_cell(j, world_height - i -1, color_theme);
+
+    if (pixel_renderer_enabled) {
+        // The finest level whose blocks are still no larger than a pixel
+        unsigned level(0);
+        while (level < density_levels && (2 << level) * pixels_per_cell <= 1) {
+            ++level;
+        }
+        // While the worker thread draws a new image, the changes pile up for it
+        const bool busy(graphic_cells_image_busy());
+        if (!busy) {
+            const bool exact(!changes_lost && !cells_image_stale
+                             && graphic_cells_image_exact(world_width, world_height, view.x_min,
+                                                          view.x_max, view.y_min, view.y_max,
+                                                          color_theme));
+            if (exact && changes.empty()) {
+                // Up to date, a new image is only drawn when something changed
+            }else if (exact && !fade_effect_enabled && changes.size() < nb_alive) {
+                // The image is only brought up to date where cells changed. Past
+                // the population, drawing the cells anew is cheaper than the changes.
+                born_cells.clear();
+                died_cells.clear();
+                for (auto& cell : changes) {
+                    if (updated_grid[world_height - 1 - cell.y][cell.x])
+                        born_cells.push_back(cell);
+                    else
+                        died_cells.push_back(cell);
+                }
+                graphic_update_cells_image(born_cells, died_cells);
+            }else if (level == 0) {
+                // The last image is painted until this one is finished
+                graphic_rasterize_cells_image(cells_in_view(view), world_width, world_height,
+                                              view.x_min, view.x_max, view.y_min, view.y_max,
+                                              color_theme, faded_cells, faded_ages);
+                cells_image_stale = false;
+            }else {
+                cells_image_stale = true;
             }
         }
+        if (level == 0) {
+            graphic_paint_cells_image(view.x_min, view.x_max, view.y_min, view.y_max);
+        }else {
+            graphic_draw_density_image(density[level - 1], (world_width + (1 << level) - 1) >> level,
+                                       (world_height + (1 << level) - 1) >> level, level,
+                                       view.x_min >> level, view.x_max >> level,
+                                       view.y_min >> level, view.y_max >> level, color_theme);
+        }
+        if (busy)
+            return;
+    }else {
+        graphic_draw_faded_cells(faded_cells, faded_ages, color_theme);
+        graphic_draw_cells(cells_in_view(view), color_theme);
     }
-#endif
+    forget_changes();
+}
+
+const std::vector<Coordinates>& simulation::get_changes() {
+    return unshown_changes;
+}
+
+bool simulation::changes_known() {
+    return !unshown_changes_lost && !fade_effect_enabled && !heatmap_enabled;
+}
+
+void simulation::clear_changes() {
+    unshown_changes.clear();
+    unshown_changes_lost = false;
 }
 
 void simulation::toggle_fade_effect() {
-    if (fade_effect_enabled) {
-        fade_effect_enabled = false;
-        dead.clear();
-        dead2.clear();
-        dead3.clear();
-        dead4.clear();
-    }else
-        fade_effect_enabled = true;
+    fade_effect_enabled = !fade_effect_enabled;
+    reset_fade();
+    // The image of the pixel renderer holds the faded cells
+    cells_image_stale = true;
+}
+
+void simulation::toggle_pixel_renderer() {
+    pixel_renderer_enabled = !pixel_renderer_enabled;
+    // The image was left behind while the cells were drawn one at a time
+    cells_image_stale = true;
+}
+
+void simulation::toggle_heatmap() {
+    heatmap_enabled = !heatmap_enabled;
+    clear_heatmap();
+}
+
+void simulation::clear_heatmap() {
+    heat.assign(heatmap_enabled ? world_width * world_height : 0, 0);
+    heat.shrink_to_fit();
+    heat_max = 0;
+    ++heat_version;
+}
+
+void simulation::draw_heatmap(BoundingBox view) {
+    view.x_max = std::min(view.x_max, world_width - 1);
+    view.y_max = std::min(view.y_max, world_height - 1);
+    if (heatmap_enabled)
+        graphic_draw_heatmap(heat, world_width, world_height, heat_max, heat_version,
+                             view.x_min, view.x_max, view.y_min, view.y_max);
+}
+
+bool simulation::save_heatmap(std::string filename) {
+    std::ofstream image(filename, std::ios::binary);
+    if (!heatmap_enabled || image.fail())
+        return false;
+
+    // Binary PGM, the top row being the highest y. The counts are shown on a
+    // logarithmic scale, the few hottest cells would hide the rest otherwise.
+    image << "P5\n" << world_width << " " << world_height << "\n255\n";
+    const double scale(heat_max > 0 ? 255 / std::log1p(heat_max) : 0);
+    std::vector<char> row(world_width);
+    for (unsigned i(0); i < world_height; ++i) {
+        const unsigned y(world_height - 1 - i);
+        for (unsigned x(0); x < world_width; ++x) {
+            row[x] = (char)(uint8_t)(std::log1p(heat[y * world_width + x]) * scale + 0.5);
+        }
+        image.write(row.data(), row.size());
+    }
+    return true;
 }
 
 Grid simulation::get_state() {
@@ -540,16 +912,6 @@ namespace {
         return OK;
     }
 
-    RLEWidthHeight get_rle_width_height(std::string line) {
-        auto x = line.find("x=");
-        auto y = line.find("y=");
-
-        unsigned width = std::stoi(std::string(x+2, y));
-        unsigned height = std::stoi(std::string(y+2, line.length()));
-
-        return {width, height};
-    }
-
     void decode_rle_body(unsigned x, unsigned y, std::string rle_body,
                          std::vector<Coordinates>& cells) {
         unsigned row(y);
@@ -599,20 +961,43 @@ namespace {
         }
     }
 
+    unsigned fade_age(unsigned x, unsigned y) {
+        const unsigned index(y * world_width + x);
+        return fade_ages[index / 2] >> (index % 2 * 4) & 0xf;
+    }
+
+    void set_fade_age(unsigned x, unsigned y, unsigned age) {
+        const unsigned index(y * world_width + x);
+        uint8_t& pair(fade_ages[index / 2]);
+        pair = (pair & ~(0xf << (index % 2 * 4))) | age << (index % 2 * 4);
+    }
+
+    void fade_start(unsigned x, unsigned y) {
+        if (fade_age(x, y) == 0)
+            fading.push_back({x, y});
+        set_fade_age(x, y, 1);
+    }
+
+    // A cell stops fading once fade_length generations old or born again
     void fade_update() {
-        dead4.clear();
-        for (unsigned i(0); i < dead3.size(); ++i) {
-            dead4.push_back(dead3[i]);
-        }
-        dead3.clear();
-        for (unsigned i(0); i < dead2.size(); ++i) {
-            dead3.push_back(dead2[i]);
-        }
-        dead2.clear();
-        for (unsigned i(0); i < dead.size(); ++i) {
-            dead2.push_back(dead[i]);
+        size_t kept(0);
+        for (size_t i(0); i < fading.size(); ++i) {
+            const Coordinates cell(fading[i]);
+            const unsigned age(fade_age(cell.x, cell.y));
+            if (age < fade_length && !updated_grid[world_height - 1 - cell.y][cell.x]) {
+                set_fade_age(cell.x, cell.y, age + 1);
+                fading[kept++] = cell;
+            }else {
+                set_fade_age(cell.x, cell.y, 0);
+            }
         }
-        dead.clear();
+        fading.resize(kept);
+    }
+
+    void reset_fade() {
+        fade_ages.assign(fade_effect_enabled ? (world_width * world_height + 1) / 2 : 0, 0);
+        fade_ages.shrink_to_fit();
+        fading.clear();
     }
 
     unsigned neighbours(unsigned x, unsigned y) {
@@ -636,6 +1021,358 @@ namespace {
         return n;
     }
 
+    void birth(unsigned x, unsigned y) {
+        if (!updated_grid[world_height - 1 - y][x]) {
+            updated_grid[world_height - 1 - y][x] = true;
+            const uint64_t key(zobrist_key(x, y));
+            const uint64_t shape(shape_key(x, y));
+            state_hash ^= key;
+            touch_tile(x, y, key, shape);
+            shape_sum = add_mod(shape_sum, shape);
+            ++born_count;
+#ifdef LIVE_ARRAY_OPTIMIZATION
+            live_cells_buffer.push_back({x, y});
+            nb_alive = live_cells_buffer.size();
+#endif
+            occupy(x, y);
+            note_change(x, y);
+        }
+    }
+
+    void death(unsigned x, unsigned y) {
+        if (updated_grid[world_height - 1 - y][x]) {
+            updated_grid[world_height - 1 - y][x] = false;
+            const uint64_t key(zobrist_key(x, y));
+            const uint64_t shape(shape_modulus - shape_key(x, y));
+            state_hash ^= key;
+            touch_tile(x, y, key, shape);
+            shape_sum = add_mod(shape_sum, shape);
+            ++dead_count;
+#ifdef LIVE_ARRAY_OPTIMIZATION
+            for (size_t i(0); i < live_cells_buffer.size(); ++i) {
+                if (live_cells_buffer[i].x == x && live_cells_buffer[i].y == y) {
+                    live_cells_buffer.erase(live_cells_buffer.begin() + i);
+                    break;
+                }
+            }
+            nb_alive = live_cells_buffer.size();
+#endif
+            vacate(x, y);
+            note_change(x, y);
+        }
+    }
+
+    void note_change(unsigned x, unsigned y) {
+        add_change(changes, changes_lost, x, y);
+        add_change(unshown_changes, unshown_changes_lost, x, y);
+    }
+
+    void add_change(std::vector<Coordinates>& list, bool& lost, unsigned x, unsigned y) {
+        if (lost)
+            return;
+        // Past that many, drawing every cell again is as cheap
+        if (list.size() == changes_max) {
+            list.clear();
+            lost = true;
+        }else
+            list.push_back({x, y});
+    }
+
+    void forget_changes() {
+        changes.clear();
+        changes_lost = false;
+    }
+
+    // Zobrist key of a cell. The keys are computed on the fly with the SplitMix64
+    // finalizer rather than stored, a table for the largest world would weigh 100 MB.
+    uint64_t zobrist_key(unsigned x, unsigned y) {
+        uint64_t z((uint64_t)y << 32 | x);
+        z += 0x9e3779b97f4a7c15;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        return z ^ (z >> 31);
+    }
+
+    void rehash_state() {
+        state_hash = 0;
+        shape_sum = 0;
+        for (unsigned i(0); i < updated_grid.size(); ++i) {
+            for (unsigned j(0); j < updated_grid[i].size(); ++j) {
+                if (updated_grid[i][j]) {
+                    state_hash ^= zobrist_key(j, world_height - 1 - i);
+                    shape_sum = add_mod(shape_sum, shape_key(j, world_height - 1 - i));
+                }
+            }
+        }
+        history_dirty = true;
+        period = 0;
+        displacement = {0, 0};
+        puffer = false;
+    }
+
+    // Look the current state up in the history, then record it. The period is set
+    // if the state was met before, or if its shape was met before at another place,
+    // or failing that if the shape of its unstable tiles was met before at another
+    // place: the rest of the pattern is settled, the moving part left it behind.
+    void record_state() {
+        period = 0;
+        displacement = {0, 0};
+        puffer = false;
+
+        HistoryEntry entry({state_hash, 0, bbox.x_min, bbox.y_min, 0, unsettled_x, unsettled_y,
+                            nb_alive});
+        auto it(hash_generation.find(state_hash));
+        if (it != hash_generation.end())
+            period = generation - it->second;
+        hash_generation[state_hash] = generation;
+
+        if (nb_alive != 0) {
+            entry.shape_hash = mul_mod(shape_sum, mul_mod(x_inverse_powers[bbox.x_min],
+                                                          y_inverse_powers[bbox.y_min]));
+            auto shape_it(shape_generation.find(entry.shape_hash));
+            if (shape_it != shape_generation.end() && period == 0) {
+                period = generation - shape_it->second;
+                const HistoryEntry& past(history[history.size() - period]);
+                displacement = {(int)bbox.x_min - (int)past.x_min,
+                                (int)bbox.y_min - (int)past.y_min};
+            }
+            shape_generation[entry.shape_hash] = generation;
+        }
+
+        if (unsettled_sum != 0) {
+            entry.unsettled_hash = mul_mod(unsettled_sum, mul_mod(x_inverse_powers[unsettled_x],
+                                                                  y_inverse_powers[unsettled_y]));
+            auto unsettled_it(unsettled_generation.find(entry.unsettled_hash));
+            if (unsettled_it != unsettled_generation.end() && period == 0) {
+                const HistoryEntry& past(history[history.size() - (generation - unsettled_it->second)]);
+                if (past.unsettled_x != unsettled_x || past.unsettled_y != unsettled_y) {
+                    period = generation - unsettled_it->second;
+                    displacement = {(int)unsettled_x - (int)past.unsettled_x,
+                                    (int)unsettled_y - (int)past.unsettled_y};
+                    puffer = nb_alive > past.population;
+                }
+            }
+            unsettled_generation[entry.unsettled_hash] = generation;
+        }
+
+        history.push_back(entry);
+        if (history.size() > period_max) {
+            // Forget the oldest state unless it was met again since
+            const HistoryEntry& oldest(history.front());
+            auto oldest_it(hash_generation.find(oldest.state_hash));
+            if (oldest_it->second == generation - period_max)
+                hash_generation.erase(oldest_it);
+            auto oldest_shape_it(shape_generation.find(oldest.shape_hash));
+            if (oldest_shape_it != shape_generation.end()
+                && oldest_shape_it->second == generation - period_max)
+                shape_generation.erase(oldest_shape_it);
+            auto oldest_unsettled_it(unsettled_generation.find(oldest.unsettled_hash));
+            if (oldest_unsettled_it != unsettled_generation.end()
+                && oldest_unsettled_it->second == generation - period_max)
+                unsettled_generation.erase(oldest_unsettled_it);
+            history.pop_front();
+        }
+    }
+
+    uint64_t add_mod(uint64_t a, uint64_t b) {
+        uint64_t sum(a + b);
+        return sum >= shape_modulus ? sum - shape_modulus : sum;
+    }
+
+    uint64_t mul_mod(uint64_t a, uint64_t b) {
+        __uint128_t product((__uint128_t)a * b);
+        uint64_t folded((uint64_t)(product & shape_modulus) + (uint64_t)(product >> 61));
+        return folded >= shape_modulus ? folded - shape_modulus : folded;
+    }
+
+    uint64_t pow_mod(uint64_t base, uint64_t exponent) {
+        uint64_t result(1);
+        while (exponent > 0) {
+            if (exponent & 1)
+                result = mul_mod(result, base);
+            base = mul_mod(base, base);
+            exponent >>= 1;
+        }
+        return result;
+    }
+
+    std::vector<uint64_t> powers(uint64_t base, unsigned n) {
+        std::vector<uint64_t> table(n);
+        table[0] = 1;
+        for (unsigned i(1); i < n; ++i) {
+            table[i] = mul_mod(table[i - 1], base);
+        }
+        return table;
+    }
+
+    uint64_t shape_key(unsigned x, unsigned y) {
+        return mul_mod(x_powers[x], y_powers[y]);
+    }
+
+    void heat_up(unsigned x, unsigned y) {
+        uint16_t& count(heat[y * world_width + x]);
+        if (count != UINT16_MAX) {
+            ++count;
+            ++heat_version;
+            if (count > heat_max)
+                heat_max = count;
+        }
+    }
+
+    void occupy(unsigned x, unsigned y) {
+        ++row_count[y];
+        ++column_count[x];
+        for (unsigned level(1); level <= density_levels; ++level) {
+            ++density[level - 1][density_index(level, x, y)];
+        }
+        if (bbox.x_min > bbox.x_max) {
+            bbox = {x, x, y, y};
+            return;
+        }
+        bbox.x_min = std::min(bbox.x_min, x);
+        bbox.x_max = std::max(bbox.x_max, x);
+        bbox.y_min = std::min(bbox.y_min, y);
+        bbox.y_max = std::max(bbox.y_max, y);
+    }
+
+    // The box only shrinks when the last cell of a border row or column
+    // dies, the counts then tell how far in the next live cell is
+    void vacate(unsigned x, unsigned y) {
+        --row_count[y];
+        --column_count[x];
+        for (unsigned level(1); level <= density_levels; ++level) {
+            --density[level - 1][density_index(level, x, y)];
+        }
+        if (nb_alive == 0) {
+            bbox = {world_width, 0, world_height, 0};
+            return;
+        }
+        while (column_count[bbox.x_min] == 0) {
+            ++bbox.x_min;
+        }
+        while (column_count[bbox.x_max] == 0) {
+            --bbox.x_max;
+        }
+        while (row_count[bbox.y_min] == 0) {
+            ++bbox.y_min;
+        }
+        while (row_count[bbox.y_max] == 0) {
+            --bbox.y_max;
+        }
+    }
+
+    // Rebuild the counts and the tiles after the world was cleared or resized
+    void recount() {
+        reset_tiles();
+        row_count.assign(world_height, 0);
+        column_count.assign(world_width, 0);
+        for (unsigned level(1); level <= density_levels; ++level) {
+            density[level - 1].assign(density_index(level, 0, world_height + (1 << level) - 1), 0);
+        }
+        bbox = {world_width, 0, world_height, 0};
+        // Force the next generation step to clear the whole grid
+        grid_bbox = {0, world_width - 1, 0, world_height - 1};
+#ifdef LIVE_ARRAY_OPTIMIZATION
+        for (auto cell : live_cells_buffer) {
+            occupy(cell.x, cell.y);
+        }
+#endif
+    }
+
+    unsigned density_index(unsigned level, unsigned x, unsigned y) {
+        return (y >> level) * ((world_width + (1 << level) - 1) >> level) + (x >> level);
+    }
+
+    // A tile that starts changing was still until now, its past states are all the current one
+    void touch_tile(unsigned x, unsigned y, uint64_t key, uint64_t shape) {
+        const unsigned index((y / tile_size) * tiles_x + x / tile_size);
+        Tile& tile(tiles[index]);
+        if (!tile.active) {
+            tile.past.fill(tile.hash);
+            tile.last_change = generation;
+            tile.period = 0;
+            tile.streak = 0;
+            tile.active = true;
+            active_tiles.push_back(index);
+        }
+        tile.hash ^= key;
+        tile.shape = add_mod(tile.shape, shape);
+    }
+
+    // Record the new state of the active tiles and look for the smallest period
+    // each of them repeats with. Tiles unchanged for a whole history are dropped.
+    // The cells of the unstable tiles are summed up in unsettled_sum.
+    void update_tiles() {
+        const unsigned depth(tile_period_max + 1);
+        unsigned kept(0);
+        unstable_tiles = 0;
+        unsettled_sum = 0;
+        unsettled_x = world_width;
+        unsettled_y = world_height;
+        for (unsigned k(0); k < active_tiles.size(); ++k) {
+            const unsigned index(active_tiles[k]);
+            Tile& tile(tiles[index]);
+            if (tile.hash != tile.past[(generation - 1) % depth])
+                tile.last_change = generation;
+            tile.past[generation % depth] = tile.hash;
+
+            unsigned p(1);
+            while (p < depth && tile.past[(generation - p) % depth] != tile.hash) {
+                ++p;
+            }
+            if (p == depth)
+                p = 0;
+            if (p == tile.period) {
+                ++tile.streak;
+            }else {
+                tile.period = p;
+                tile.streak = 0;
+            }
+
+            if (generation - tile.last_change >= depth) {
+                tile.active = false;
+                continue;
+            }
+            if (tile.period == 0 || tile.streak < tile_confirmation) {
+                ++unstable_tiles;
+                unsettled_sum = add_mod(unsettled_sum, tile.shape);
+                unsettled_x = std::min(unsettled_x, index % tiles_x * tile_size);
+                unsettled_y = std::min(unsettled_y, index / tiles_x * tile_size);
+            }
+            active_tiles[kept++] = index;
+        }
+        active_tiles.resize(kept);
+        if (unstable_tiles == 0)
+            unsettled_x = unsettled_y = 0;
+    }
+
+    // All tiles start settled (value-initialized), with the hash of the cells they hold
+    void reset_tiles() {
+        tiles_x = (world_width + tile_size - 1) / tile_size;
+        const unsigned tiles_y((world_height + tile_size - 1) / tile_size);
+        tiles.assign(tiles_x * tiles_y, Tile());
+        active_tiles.clear();
+        unstable_tiles = 0;
+        unsettled_sum = 0;
+        unsettled_x = unsettled_y = 0;
+#ifdef LIVE_ARRAY_OPTIMIZATION
+        for (auto cell : live_cells_buffer) {
+            Tile& tile(tiles[(cell.y / tile_size) * tiles_x + cell.x / tile_size]);
+            tile.hash ^= zobrist_key(cell.x, cell.y);
+            tile.shape = add_mod(tile.shape, shape_key(cell.x, cell.y));
+        }
+#endif
+    }
+
+    unsigned gcd(unsigned a, unsigned b) {
+        while (b != 0) {
+            unsigned r(a % b);
+            a = b;
+            b = r;
+        }
+        return a;
+    }
+
     void print_selection(unsigned i_min, unsigned i_max, unsigned j_min, unsigned j_max) {
         unsigned w(j_max/5 - j_min/5);
         unsigned h(i_max/5 - i_min/5);
@@ -692,4 +1429,47 @@ namespace {
             std::cout << "|\n\n";
         }
     }
+
+    bool in_view(const Coordinates& cell, const simulation::BoundingBox& view) {
+        return cell.x >= view.x_min && cell.x <= view.x_max
+               && cell.y >= view.y_min && cell.y <= view.y_max;
+    }
+
+    // @return The live cells in view. The grid is scanned if the part of the
+    // view holding live cells is smaller than the population, the list of the
+    // live cells is filtered otherwise, or taken as is if they are all in view.
+    const std::vector<Coordinates>& cells_in_view(simulation::BoundingBox view) {
+        view_cells.clear();
+        if (view.x_min <= bbox.x_min && view.x_max >= bbox.x_max
+            && view.y_min <= bbox.y_min && view.y_max >= bbox.y_max) {
+#ifdef LIVE_ARRAY_OPTIMIZATION
+            return live_cells_buffer;
+#endif
+        }
+        view.x_min = std::max(view.x_min, bbox.x_min);
+        view.x_max = std::min(view.x_max, bbox.x_max);
+        view.y_min = std::max(view.y_min, bbox.y_min);
+        view.y_max = std::min(view.y_max, bbox.y_max);
+        if (view.x_min > view.x_max || view.y_min > view.y_max)
+            return view_cells;
+#ifdef LIVE_ARRAY_OPTIMIZATION
+        const unsigned long area((unsigned long)(view.x_max - view.x_min + 1)
+                                 * (view.y_max - view.y_min + 1));
+        if (area >= live_cells_buffer.size()) {
+            for (auto& cell : live_cells_buffer) {
+                if (in_view(cell, view))
+                    view_cells.push_back(cell);
+            }
+            return view_cells;
+        }
+#endif
+        for (unsigned y(view.y_min); y <= view.y_max; ++y) {
+            const std::vector<bool>& row(updated_grid[world_height - 1 - y]);
+            for (unsigned x(view.x_min); x <= view.x_max; ++x) {
+                if (row[x])
+                    view_cells.push_back({x, y});
+            }
+        }
+        return view_cells;
+    }
 } /* unnamed namespace */
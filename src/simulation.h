@@ -31,6 +31,7 @@
 #include <string>
 #include "config.h"
 #include "graphic.h"
+#include "timeseries.h"
 
 
 typedef std::vector<std::vector<bool>> Grid;
@@ -38,6 +39,19 @@ typedef std::vector<std::vector<bool>> Grid;
 
 namespace simulation {
     enum Mode { NORMAL, EXPERIMENTAL };
+
+    struct BoundingBox {
+        unsigned x_min;
+        unsigned x_max;
+        unsigned y_min;
+        unsigned y_max;
+    };
+
+    struct Displacement {
+        int dx;
+        int dy;
+    };
+
     /**
      * Erase the absolute file path to keep only the file name.
      */
@@ -64,6 +78,28 @@ namespace simulation {
     */
     std::vector<Coordinates> get_rle_data(std::string filename);
 
+    /**
+     * Decode RLE format under any rule.
+     * @param filename RLE file to be read.
+     * @param rule Set to the rule of the header line without its topology
+     * (":T100,100"), with or without '=' after "rule", "B3/S23" if there is none.
+     * @return The live cells, in the same orientation as get_rle_data().
+     */
+    std::vector<Coordinates> get_rle_data(std::string filename, std::string& rule);
+
+    /**
+     * Encode RLE format, with the same orientation as get_rle_data().
+     * @param cells The live cells of the pattern.
+     * @param rule Rule written in the header line.
+     * @return The header line and the body, lines at most 70 characters long.
+     */
+    std::string encode_rle(const std::vector<Coordinates>& cells, std::string rule = "B3/S23");
+
+    /**
+     * @return The coordinates of all the live cells, in no particular order.
+     */
+    std::vector<Coordinates> get_live_cells();
+
     /**
      * Get all live cells within a rectangular area.
      * @return A vector storing the coordinates couples.
@@ -74,7 +110,10 @@ namespace simulation {
     /** 
      * Update the simulation (compute the n+1 state).
      * @param mode The specified simulation mode.
-     * @return <tt>true</tt> if the simulation has stabilized (requires EXPERIMENTAL mode).
+     * @return <tt>true</tt> if the simulation has stabilized (requires EXPERIMENTAL mode),
+     * i.e. the new state was already met during the last <tt>period_max</tt> generations,
+     * possibly at another place (spaceship), or its unstable tiles of the stability map
+     * were met at another place (puffer), or every tile of the stability map is settled.
      */
     bool update(Mode mode = NORMAL);
 
@@ -86,6 +125,58 @@ namespace simulation {
     bool is_alive(unsigned x, unsigned y);
     unsigned get_population();
 
+    /**
+     * @return The period of the cycle the simulation entered, or 0 if the
+     * last generation did not repeat a previous state.
+     */
+    unsigned get_period();
+
+    /**
+     * @return The translation of the pattern over one period, (0, 0) unless
+     * the pattern is a spaceship. When only the unstable tiles of the stability
+     * map repeat, it is their translation, a multiple of <tt>tile_size</tt>
+     * in each direction, and the period is a multiple of the period of the
+     * moving part.
+     */
+    Displacement get_displacement();
+
+    /**
+     * @return <tt>true</tt> if only the unstable tiles repeat at another place
+     * and the population grew meanwhile: the moving part leaves a settled
+     * trail behind it.
+     */
+    bool is_puffer();
+
+    /**
+     * @return The speed of the spaceship in the usual notation (e.g. "c/4 diagonal"),
+     * or an empty string if the pattern does not move.
+     */
+    std::string get_speed();
+
+    /**
+     * @return <tt>true</tt> if every tile of the stability map is either still
+     * or periodic with a period up to <tt>tile_period_max</tt>.
+     */
+    bool is_settled();
+
+    /**
+     * Call a graphic function to draw the tiles that are still evolving and
+     * the ones that oscillate.
+     */
+    void draw_stability_map();
+
+    /**
+     * @return The bounding box of the live cells, kept up to date by every
+     * birth and death. x_min > x_max if there are no live cells.
+     */
+    BoundingBox get_bounding_box();
+
+    /**
+     * @return The population, births, deaths and bounding box of the
+     * generations computed since the last init().
+     */
+    const TimeSeries& get_time_series();
+
     /**
      * Resize the bidimensional boolean grids.
      */
@@ -97,12 +188,67 @@ namespace simulation {
     void clear_pattern(unsigned x, unsigned y, std::vector<Coordinates> pattern);
 
     /**
-     * Call a graphic function to draw the live cells.
+     * Call a graphic function to draw the live cells, from an image of the
+     * world if the pixel renderer is enabled or one cell at a time otherwise.
+     * @param view The part of the world in sight, the cells out of it are not
+     * visited: the cost follows the smaller of its area and the population.
+     * @param pixels_per_cell Scale of the drawing. When cells are smaller than
+     * a pixel, the pixel renderer draws the share of live cells in blocks of
+     * about a pixel instead, the cost follows the number of pixels.
+     */
+    void draw_cells(unsigned color_theme, BoundingBox view, double pixels_per_cell = 1);
+
+    /**
+     * @return The cells whose state changed since the last clear_changes(),
+     * only meaningful if changes_known(). Drawing the cells does not clear
+     * them, so a partial repaint in between does not hide them.
+     */
+    const std::vector<Coordinates>& get_changes();
+
+    /**
+     * @return Whether redrawing the cells of get_changes() is enough to show
+     * the current state: not if they were too many to be kept, the world was
+     * reset or resized, or the fade effect or the heatmap is enabled.
+     */
+    bool changes_known();
+
+    /**
+     * Forget the changes once their area has been asked to be repainted.
      */
-    void draw_cells(unsigned color_theme);
+    void clear_changes();
 
     void toggle_fade_effect();
 
+    /**
+     * Switch between the pixel renderer, enabled at startup, and the drawing
+     * of one cell at a time.
+     */
+    void toggle_pixel_renderer();
+
+    /**
+     * Start or stop counting, for each cell, how many times it changed state
+     * during the generation steps. The counts are reset either way.
+     */
+    void toggle_heatmap();
+
+    /**
+     * Reset the heatmap counts to zero.
+     */
+    void clear_heatmap();
+
+    /**
+     * Call a graphic function to draw the heatmap over the cells in view, if
+     * it is enabled.
+     */
+    void draw_heatmap(BoundingBox view);
+
+    /**
+     * Save the heatmap as a grayscale image, on a logarithmic scale.
+     * @param filename Binary PGM (.pgm) file to be written.
+     * @return <tt>false</tt> if the heatmap is disabled or the file could not be written.
+     */
+    bool save_heatmap(std::string filename);
+
     // TODO: getters and setter might indicate a class would be welcome here
     Grid get_state();
     unsigned get_width();
@@ -0,0 +1,128 @@
+/*
+ * timeseries.cc
+ * This file is part of GoL Lab, a simulator of Conway's game of life.
+ *
+ * Copyright (C) 2022-2023 Cyprien Lacassagne
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <algorithm>
+#include "timeseries.h"
+
+namespace {
+    Summary summarise(unsigned value);
+    // Fold the summary b of nb generations into the summary a of na generations
+    void fold(Summary& a, unsigned long na, const Summary& b, unsigned long nb);
+    void fold(Bucket& a, const Bucket& b);
+} /* unnamed namespace */
+
+TimeSeries::TimeSeries()
+:   levels(series_levels),
+    n_recorded(0) {
+    unsigned long span(1);
+    for (auto& level : levels) {
+        level.span = span;
+        level.pending.n_generations = 0;
+        level.truncated = false;
+        span *= series_factor;
+    }
+}
+
+void TimeSeries::record(unsigned long generation, const Sample& sample) {
+    merge(0, {generation, 1, summarise(sample.population), summarise(sample.births),
+              summarise(sample.deaths), summarise(sample.width), summarise(sample.height)});
+    ++n_recorded;
+}
+
+void TimeSeries::clear() {
+    for (auto& level : levels) {
+        level.buckets.clear();
+        level.pending.n_generations = 0;
+        level.truncated = false;
+    }
+    n_recorded = 0;
+}
+
+unsigned long TimeSeries::size() const {
+    return n_recorded;
+}
+
+std::vector<Bucket> TimeSeries::overview(unsigned max_buckets) const {
+    unsigned chosen(levels.size() - 1);
+    for (unsigned i(0); i < levels.size(); ++i) {
+        if (!levels[i].truncated && levels[i].buckets.size() + 1 <= max_buckets) {
+            chosen = i;
+            break;
+        }
+    }
+    std::vector<Bucket> buckets(levels[chosen].buckets.begin(), levels[chosen].buckets.end());
+
+    // The latest generations are still in the buckets being filled, from the
+    // oldest in the chosen level to the newest in the first level
+    Bucket tail(levels[chosen].pending);
+    for (unsigned i(chosen); i-- > 0;) {
+        if (levels[i].pending.n_generations == 0)
+            continue;
+        if (tail.n_generations == 0)
+            tail = levels[i].pending;
+        else
+            fold(tail, levels[i].pending);
+    }
+    if (tail.n_generations != 0)
+        buckets.push_back(tail);
+    return buckets;
+}
+
+// Add a bucket to a level. Each time a bucket of the level is complete, it
+// is kept and passed on to the next level.
+void TimeSeries::merge(unsigned index, const Bucket& bucket) {
+    Level& level(levels[index]);
+    if (level.pending.n_generations == 0)
+        level.pending = bucket;
+    else
+        fold(level.pending, bucket);
+    if (level.pending.n_generations < level.span)
+        return;
+
+    level.buckets.push_back(level.pending);
+    if (level.buckets.size() > series_capacity) {
+        level.buckets.pop_front();
+        level.truncated = true;
+    }
+    level.pending.n_generations = 0;
+    if (index + 1 < levels.size())
+        merge(index + 1, level.buckets.back());
+}
+
+namespace {
+    Summary summarise(unsigned value) {
+        return {value, value, (double)value};
+    }
+
+    void fold(Summary& a, unsigned long na, const Summary& b, unsigned long nb) {
+        a.min = std::min(a.min, b.min);
+        a.max = std::max(a.max, b.max);
+        a.mean = (a.mean * na + b.mean * nb) / (na + nb);
+    }
+
+    void fold(Bucket& a, const Bucket& b) {
+        fold(a.population, a.n_generations, b.population, b.n_generations);
+        fold(a.births, a.n_generations, b.births, b.n_generations);
+        fold(a.deaths, a.n_generations, b.deaths, b.n_generations);
+        fold(a.width, a.n_generations, b.width, b.n_generations);
+        fold(a.height, a.n_generations, b.height, b.n_generations);
+        a.n_generations += b.n_generations;
+    }
+} /* unnamed namespace */
@@ -0,0 +1,111 @@
+/*
+ * timeseries.h
+ * This module records the population, births, deaths and bounding box of
+ * each generation. The samples are kept at several resolutions: the
+ * recent generations one by one, the older ones summarised by buckets
+ * of growing length, so that the memory used stays bounded however long
+ * the simulation runs.
+ *
+ * This file is part of GoL Lab, a simulator of Conway's game of life.
+ *
+ * Copyright (C) 2022-2023 Cyprien Lacassagne
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef TIMESERIES_H
+#define TIMESERIES_H
+
+#include <deque>
+#include <vector>
+
+// Buckets kept at each resolution
+constexpr unsigned series_capacity(512);
+// Number of buckets of a level merged into one bucket of the next level
+constexpr unsigned series_factor(4);
+// The last level covers series_capacity * series_factor^(series_levels - 1)
+// generations, about 2 billion
+constexpr unsigned series_levels(12);
+
+struct Sample {
+    unsigned population;
+    unsigned births;
+    unsigned deaths;
+    unsigned width;
+    unsigned height;
+};
+
+// Smallest, largest and mean value of a quantity over a bucket
+struct Summary {
+    unsigned min;
+    unsigned max;
+    double mean;
+};
+
+struct Bucket {
+    unsigned long first_generation;
+    unsigned long n_generations;
+    Summary population;
+    Summary births;
+    Summary deaths;
+    Summary width;
+    Summary height;
+};
+
+class TimeSeries {
+public:
+    TimeSeries();
+
+    /**
+     * Add the sample of the next generation.
+     * @param generation The generation the sample was taken at.
+     */
+    void record(unsigned long generation, const Sample& sample);
+
+    /**
+     * Forget all the samples.
+     */
+    void clear();
+
+    /**
+     * @return The number of generations recorded since the last clear().
+     */
+    unsigned long size() const;
+
+    /**
+     * Summarise the recorded generations with at most max_buckets buckets,
+     * at the finest resolution that fits. The oldest generations are missing
+     * if even the coarsest resolution has dropped them.
+     * @return The buckets in chronological order, the last one may be shorter.
+     */
+    std::vector<Bucket> overview(unsigned max_buckets) const;
+
+private:
+    struct Level {
+        // Generations summarised by each bucket of the level
+        unsigned long span;
+        std::deque<Bucket> buckets;
+        // Bucket being filled, empty if n_generations is 0
+        Bucket pending;
+        // Set once the oldest buckets have been dropped
+        bool truncated;
+    };
+
+    void merge(unsigned level, const Bucket& bucket);
+
+    std::vector<Level> levels;
+    unsigned long n_recorded;
+};
+
+#endif
@@ -0,0 +1,63 @@
+/*
+ * rle_test.cc
+ * This file is part of GoL Lab, a simulator of Conway's game of life.
+ *
+ * Copyright (C) 2022-2023 Cyprien Lacassagne
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "simulation.h"
+
+namespace {
+    const std::string test_file("rle_test.rle");
+    unsigned n_failures(0);
+
+    // Read a glider written with the header line given
+    void check_header(std::string header, std::string expected_rule, bool expected_life) {
+        {
+            std::ofstream file(test_file);
+            file << "#C Glider\n" << header << "\nbo$2bo$3o!\n";
+        }
+        std::string rule;
+        const std::vector<Coordinates> cells(simulation::get_rle_data(test_file, rule));
+        const std::vector<Coordinates> life_cells(simulation::get_rle_data(test_file));
+        std::remove(test_file.c_str());
+
+        if (rule != expected_rule || cells.size() != 5 || life_cells.empty() == expected_life) {
+            std::cerr << "FAILED \"" << header << "\": rule \"" << rule << "\" instead of \""
+                      << expected_rule << "\", " << cells.size() << " cells, "
+                      << life_cells.size() << " cells under B3/S23" << std::endl;
+            ++n_failures;
+        }
+    }
+} /* unnamed namespace */
+
+int main() {
+    check_header("x = 3, y = 3, rule = B3/S23", "B3/S23", true);
+    check_header("x = 3, y = 3, rule B3/S23", "B3/S23", true);
+    check_header("x = 3, y = 3, rule=B36/S23:T100,100", "B36/S23", false);
+    check_header("x = 3, y = 3, rule B36/S23", "B36/S23", false);
+    check_header("x = 3, y = 3, rule", "B3/S23", true);
+    check_header("x = 3, y = 3", "B3/S23", true);
+
+    if (n_failures == 0)
+        std::cout << "All the RLE headers were read" << std::endl;
+    return n_failures == 0 ? 0 : 1;
+}